@@ -0,0 +1,96 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+import QtQuick 2.8
+import AdvancedViews 1.0
+
+// A vertical list of the rows of the first column of the model, made of
+// the single column of a TableViewPrivate stretched over the list. Items are
+// as high as their implicit height unless autoItemHeight is false
+Flickable {
+    id: root
+
+    property alias model: view.model
+    // Without a model, count sets the number of items
+    property alias count: view.rowCount
+    property alias defaultItemHeight: view.defaultRowHeight
+    property alias autoItemHeight: view.autoRowHeight
+    property alias delegate: view.cellDelegate
+    property alias delegateChooser: view.delegateChooser
+    property alias cacheBuffer: view.verticalCacheBuffer
+    property alias incubationBudget: view.incubationBudget
+    property alias poolSize: view.poolSize
+    property alias poolIdleTimeout: view.poolIdleTimeout
+    readonly property alias poolHighWaterMark: view.poolHighWaterMark
+    property alias lightweightItems: view.lightweightCells
+
+    contentWidth: width
+    contentHeight: view.height
+    flickableDirection: Flickable.VerticalFlick
+
+    // Position of the visible area and height of the whole list, which
+    // may be larger than the content of the flickable
+    readonly property real listY: view.origin.y + contentY
+    readonly property real listHeight: view.tableSize.height
+
+    function itemAt(index) {
+        return view.itemAt(index, 0)
+    }
+
+    function trimCache() {
+        view.trimCache()
+    }
+
+    function hideItems(index, count) {
+        return view.hideRows(index, count)
+    }
+
+    function showItems(index, count) {
+        return view.showRows(index, count)
+    }
+
+    // Show the point y of the list at the top of the view
+    function scrollTo(y) {
+        cancelFlick()
+        view.scrollTo(Qt.point(0, y))
+    }
+
+    TableViewPrivate {
+        id: view
+        columnCount: 1
+        // The column stretches over the view, so that a change of width
+        // resizes the live items without laying out the column again
+        defaultColumnWidth: 1
+        stretchLastColumn: true
+        autoRowHeight: true
+        visibleArea: Qt.rect(root.contentX, root.contentY, root.width, root.height)
+        velocity: Qt.point(root.horizontalVelocity, root.verticalVelocity)
+        moving: root.moving
+        dragging: root.dragging
+
+        // Moving the content stops a flick, which goes on at the same velocity
+        onContentShifted: {
+            var flicking = root.flicking
+            var horizontalVelocity = root.horizontalVelocity
+            var verticalVelocity = root.verticalVelocity
+            root.contentX += delta.x
+            root.contentY += delta.y
+            if (flicking)
+                root.flick(-horizontalVelocity, -verticalVelocity)
+        }
+    }
+}
@@ -21,14 +21,112 @@ import AdvancedViews 1.0
 Flickable {
     id: root
 
+    property alias model: view.model
+    property alias rowCount: view.rowCount
+    property alias columnCount: view.columnCount
+    property alias defaultRowHeight: view.defaultRowHeight
+    property alias autoRowHeight: view.autoRowHeight
+    property alias tree: view.tree
+    property alias defaultColumnWidth: view.defaultColumnWidth
+    property alias stretchLastColumn: view.stretchLastColumn
+    property alias frozenRows: view.frozenRows
+    property alias frozenColumns: view.frozenColumns
     property alias cellDelegate: view.cellDelegate
+    property alias delegateChooser: view.delegateChooser
+    property alias horizontalCacheBuffer: view.horizontalCacheBuffer
+    property alias verticalCacheBuffer: view.verticalCacheBuffer
+    property alias incubationBudget: view.incubationBudget
+    property alias poolSize: view.poolSize
+    property alias poolIdleTimeout: view.poolIdleTimeout
+    readonly property alias poolHighWaterMark: view.poolHighWaterMark
+    property alias lightweightCells: view.lightweightCells
+    property alias delegateColumns: view.delegateColumns
 
     contentWidth: view.width
     contentHeight: view.height
 
+    // Position of the visible area and size of the whole table, which
+    // may be larger than the content of the flickable
+    readonly property real tableX: view.origin.x + contentX
+    readonly property real tableY: view.origin.y + contentY
+    readonly property real tableWidth: view.tableSize.width
+    readonly property real tableHeight: view.tableSize.height
+
+    function itemAt(row, column) {
+        return view.itemAt(row, column)
+    }
+
+    function trimCache() {
+        view.trimCache()
+    }
+
+    function setSpan(row, column, rowSpan, columnSpan) {
+        return view.setSpan(row, column, rowSpan, columnSpan)
+    }
+
+    function clearSpans() {
+        view.clearSpans()
+    }
+
+    function setRowOrder(order) {
+        return view.setRowOrder(order)
+    }
+
+    function setColumnOrder(order) {
+        return view.setColumnOrder(order)
+    }
+
+    function hideRows(row, count) {
+        return view.hideRows(row, count)
+    }
+
+    function showRows(row, count) {
+        return view.showRows(row, count)
+    }
+
+    function hideColumns(column, count) {
+        return view.hideColumns(column, count)
+    }
+
+    function showColumns(column, count) {
+        return view.showColumns(column, count)
+    }
+
+    function expand(row) {
+        return view.expand(row)
+    }
+
+    function collapse(row) {
+        return view.collapse(row)
+    }
+
+    function isExpanded(row) {
+        return view.isExpanded(row)
+    }
+
+    // Show the point x, y of the table at the top left of the view
+    function scrollTo(x, y) {
+        cancelFlick()
+        view.scrollTo(Qt.point(x, y))
+    }
+
     TableViewPrivate {
         id: view
         visibleArea: Qt.rect(root.contentX, root.contentY, root.width, root.height)
+        velocity: Qt.point(root.horizontalVelocity, root.verticalVelocity)
+        moving: root.moving
+        dragging: root.dragging
         cellDelegate: root.cellDelegate
+
+        // Moving the content stops a flick, which goes on at the same velocity
+        onContentShifted: {
+            var flicking = root.flicking
+            var horizontalVelocity = root.horizontalVelocity
+            var verticalVelocity = root.verticalVelocity
+            root.contentX += delta.x
+            root.contentY += delta.y
+            if (flicking)
+                root.flick(-horizontalVelocity, -verticalVelocity)
+        }
     }
 }
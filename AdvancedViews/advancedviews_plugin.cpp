@@ -16,6 +16,7 @@
 */
 
 #include "advancedviews_plugin.h"
+#include "delegatechooser.h"
 #include "tableviewprivate.h"
 
 #include <qqml.h>
@@ -24,7 +25,10 @@
 void AdvancedViewsPlugin::registerTypes(const char *uri)
 {
     qmlRegisterType(QUrl("qrc:///AdvancedViews/TableView.qml"), uri, 1, 0, "TableView");
+    qmlRegisterType(QUrl("qrc:///AdvancedViews/ListView.qml"), uri, 1, 0, "ListView");
     // @uri AdvancedViews
     qmlRegisterType<TableViewPrivate>(uri, 1, 0, "TableViewPrivate");
+    qmlRegisterType<DelegateChooser>(uri, 1, 0, "DelegateChooser");
+    qmlRegisterType<DelegateChoice>(uri, 1, 0, "DelegateChoice");
 }
 
@@ -18,8 +18,8 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <vector>
-#include <math.h>
 #include <numeric>
 
 #include <range.h>
@@ -30,7 +30,7 @@
 
 struct AxisGetResult
 {
-    constexpr AxisGetResult(int pos = -1, int visualPos = -1, int visualLength = -1)
+    constexpr AxisGetResult(int pos = -1, std::int64_t visualPos = -1, int visualLength = -1)
         : pos(pos)
         , visualPos(visualPos)
         , visualLength(visualLength)
@@ -43,10 +43,13 @@ struct AxisGetResult
     }
 
     int pos;
-    int visualPos;
+    std::int64_t visualPos;
     int visualLength;
 };
 
+// Axis keeps its ranges in a vector with their cumulative offsets. Lookups
+// are logarithmic while mutations are linear, so only spans of elements are
+// resized here and resizing single elements is left to TreeAxis
 class Axis
 {
     friend class AdvancedViewsTest;
@@ -58,71 +61,130 @@ public:
         fixRanges();
     }
 
+    void append(const std::vector<int> &visualLengths)
+    {
+        m_ranges.reserve(m_ranges.size() + visualLengths.size());
+        for (int visualLength : visualLengths)
+            m_ranges.push_back(Range(1, visualLength));
+        fixRanges();
+    }
+
     bool move(int from, int to) {
+        return move(from, 1, to);
+    }
+
+    // Move count elements starting from from before the element at to.
+    // The destination is expressed in positions before the move
+    bool move(int from, int count, int to)
+    {
         const int length = this->length();
-        if (from < 0 || to < 0 || from >= length || to > length)
+        if (from < 0 || count < 0 || to < 0 || from + count > length || to > length)
             return false;
-        if (from == to) // Nothing to do
+        if (to >= from && to <= from + count) // Nothing to do
             return true;
-        const int visualLength = get(from)->visualLength;
-        removeAt(from);
-        insertAt(from > to ? to : (to - 1), visualLength);
+
+        // Cut the ranges at the span boundaries and rotate them
+        const int first = std::min(from, to);
+        const int middle = to < from ? from : from + count;
+        const int last = to < from ? from + count : to;
+        const std::size_t firstIndex = splitAt(first);
+        const std::size_t middleIndex = splitAt(middle);
+        const std::size_t lastIndex = splitAt(last);
+        std::rotate(std::next(m_ranges.begin(), firstIndex),
+                    std::next(m_ranges.begin(), middleIndex),
+                    std::next(m_ranges.begin(), lastIndex));
+        fixRanges();
         return true;
     }
 
-    bool insertAt(int pos, int visualLength)
+    // Reorder the elements so that the element at pos is the one at
+    // order[pos] before. The axis is rebuilt in one pass whatever the number
+    // of displaced elements
+    bool permute(const std::vector<int> &order)
     {
-        if (pos < 0 || pos > length())
+        const int length = this->length();
+        if (static_cast<int>(order.size()) != length)
             return false;
-
-        int i = 0;
-        for (auto it = m_ranges.begin(); it != m_ranges.end(); ++it) {
-            const int start = i;
-            const int end = start + it->length();
-            if (pos == start) {
-                // prepend
-                m_ranges.insert(it, Range(1, visualLength));
-                fixRanges();
-                return true;
-            } else if (pos == end) {
-                // append after this range
-                m_ranges.insert(std::next(it), Range(1, visualLength));
-                fixRanges();
-                return true;
-            } else if (pos > start && pos < end) {
-                // Split this range in two and add the new one in the middle
-                *it = Range(pos - start, it->elementVisualLength());
-                m_ranges.insert(std::next(it), {Range(1, visualLength), Range(end - pos, it->elementVisualLength())});
-                fixRanges();
-                return true;
-            } else {
-                // continue
-                i = end;
-            }
+        std::vector<Range> elements;
+        elements.reserve(order.size());
+        for (const Range &range : m_ranges)
+            elements.insert(elements.end(), range.length(), range.resized(1));
+        std::vector<bool> seen(order.size(), false);
+        std::vector<Range> ranges;
+        for (int pos : order) {
+            if (pos < 0 || pos >= length || seen[pos])
+                return false;
+            seen[pos] = true;
+            ranges.push_back(elements[pos]);
         }
-
-        m_ranges.push_back(Range(1, visualLength));
+        std::swap(m_ranges, ranges);
         fixRanges();
         return true;
     }
 
+    bool insertAt(int pos, int visualLength)
+    {
+        return insertAt(pos, Range(1, visualLength));
+    }
+
+    // Insert range.length() elements of range.elementVisualLength() at pos
+    bool insertAt(int pos, Range range)
+    {
+        if (pos < 0 || pos > length() || range.length() < 0)
+            return false;
+        replace(pos, 0, range);
+        return true;
+    }
+
     bool removeAt(int pos)
     {
-        if (pos < 0)
+        return removeAt(pos, 1);
+    }
+
+    // Remove count elements starting from pos
+    bool removeAt(int pos, int count)
+    {
+        if (pos < 0 || count < 0 || pos + count > length())
             return false;
-        int i = 0;
-        for (Range& r : m_ranges) {
-            i += r.length();
-            if (pos < i) {
-                r.resize(r.length() - 1);
-                fixRanges();
-                return true;
-            }
-        }
-        return false;
+        replace(pos, count, Range(0, 0));
+        return true;
+    }
+
+    // Set the visual length of count elements starting from pos, which
+    // become fixed. Hidden elements stay hidden
+    bool setVisualLength(int pos, int count, int visualLength)
+    {
+        if (pos < 0 || count < 0 || pos + count > length())
+            return false;
+        const std::size_t first = splitAt(pos);
+        const std::size_t last = splitAt(pos + count);
+        for (std::size_t index = first; index < last; ++index)
+            m_ranges[index] = Range(m_ranges[index].length(), visualLength, m_ranges[index].hideCount(), true);
+        fixRanges();
+        return true;
+    }
+
+    // Hide count elements starting from pos. Hidden elements keep their
+    // position but take no visual space. Hides nest, so an element is
+    // shown again only once every hide is undone by a show
+    bool hide(int pos, int count)
+    {
+        return addHideCount(pos, count, 1);
+    }
+
+    // Undo a hide of count elements starting from pos. Nothing is done
+    // if any of them is not hidden
+    bool show(int pos, int count)
+    {
+        return addHideCount(pos, count, -1);
+    }
+
+    bool isHidden(int pos) const
+    {
+        return pos >= 0 && pos < length() && m_ranges[rangeIndex(pos)].hidden();
     }
 
-    bool visualRemoveAt(int visualPos)
+    bool visualRemoveAt(std::int64_t visualPos)
     {
         std::optional<AxisGetResult> result = visualGet(visualPos);
         return result ? removeAt(result->pos) : false;
@@ -130,63 +192,159 @@ public:
 
     int length() const
     {
-        return stdutils::reduce(m_ranges, &Range::length, 0);
+        return m_offsets.back().pos;
     }
 
-    int visualLength() const
+    std::int64_t visualLength() const
     {
-        return stdutils::reduce(m_ranges, &Range::visualLength, 0);
+        return m_offsets.back().visualPos;
     }
 
     std::optional<AxisGetResult> get(int pos) const
     {
-        if (pos < 0)
+        if (pos < 0 || pos >= length())
             return std::optional<AxisGetResult>();
-        int i = 0, v = 0;
-        for (const Range &r : m_ranges) {
-            if (pos < (i + r.length())) {
-                AxisGetResult result;
-                result.pos = pos;
-                result.visualPos = v + (pos - i) * r.elementVisualLength();
-                result.visualLength = r.elementVisualLength();
-                return result;
-            }
-            i += r.length();
-            v += r.visualLength();
+        if (m_ranges.size() == 1) {
+            const int elementVisualLength = m_ranges.front().visibleElementVisualLength();
+            return AxisGetResult(pos, static_cast<std::int64_t>(pos) * elementVisualLength, elementVisualLength);
         }
-        return std::optional<AxisGetResult>();
+        const std::size_t index = rangeIndex(pos);
+        const Range &range = m_ranges[index];
+        const RangeOffset &offset = m_offsets[index];
+        AxisGetResult result;
+        result.pos = pos;
+        result.visualPos = offset.visualPos + static_cast<std::int64_t>(pos - offset.pos) * range.visibleElementVisualLength();
+        result.visualLength = range.visibleElementVisualLength();
+        return result;
     }
 
-    std::optional<AxisGetResult> visualGet(int visualPos) const
+    std::optional<AxisGetResult> visualGet(std::int64_t visualPos) const
     {
-        std::optional<AxisGetResult> result;
-        int minVisualPos = 0;
-        int numElements = 0;
-        int maxVisualPos = 0;
-        for (const Range &range : m_ranges) {
-            maxVisualPos = minVisualPos + range.visualLength();
-            if (minVisualPos <= visualPos && visualPos < maxVisualPos) {
-                const int visualOffset = visualPos - minVisualPos;
-                const int pos = std::floor(visualOffset / range.elementVisualLength());
-                result = AxisGetResult();
-                result->pos = numElements + pos;
-                result->visualPos = minVisualPos + pos * range.elementVisualLength();
-                result->visualLength = range.elementVisualLength();
-                return result;
-            }
-            minVisualPos = maxVisualPos;
-            numElements += range.length();
+        if (visualPos < 0 || visualPos >= visualLength())
+            return std::optional<AxisGetResult>();
+        if (m_ranges.size() == 1) {
+            const int elementVisualLength = m_ranges.front().visibleElementVisualLength();
+            const int pos = static_cast<int>(visualPos / elementVisualLength);
+            return AxisGetResult(pos, static_cast<std::int64_t>(pos) * elementVisualLength, elementVisualLength);
         }
+        // The range found is never hidden since hidden ranges have no extent
+        const std::size_t index = visualRangeIndex(visualPos);
+        const Range &range = m_ranges[index];
+        const RangeOffset &offset = m_offsets[index];
+        const std::int64_t visualOffset = visualPos - offset.visualPos;
+        const int pos = static_cast<int>(visualOffset / range.visibleElementVisualLength());
+        AxisGetResult result;
+        result.pos = offset.pos + pos;
+        result.visualPos = offset.visualPos + static_cast<std::int64_t>(pos) * range.visibleElementVisualLength();
+        result.visualLength = range.visibleElementVisualLength();
         return result;
     }
 
+    // Invoke callable with the AxisGetResult of every element in [first, last]
+    template<typename Callable>
+    void forEach(int first, int last, Callable &&callable) const
+    {
+        forEach(first, last, false, callable);
+    }
+
+    // Invoke callable with the AxisGetResult of every element in [first, last]
+    // taking visual space
+    template<typename Callable>
+    void forEachVisible(int first, int last, Callable &&callable) const
+    {
+        forEach(first, last, true, callable);
+    }
+
 private:
+    template<typename Callable>
+    void forEach(int first, int last, bool visibleOnly, Callable &callable) const
+    {
+        first = std::max(first, 0);
+        last = std::min(last, length() - 1);
+        if (first > last)
+            return;
+        for (std::size_t index = rangeIndex(first); index < m_ranges.size(); ++index) {
+            const Range &range = m_ranges[index];
+            const RangeOffset &offset = m_offsets[index];
+            const int end = std::min(last + 1, offset.pos + range.length());
+            if (visibleOnly && range.visibleElementVisualLength() == 0) {
+                if (end > last)
+                    return;
+                continue;
+            }
+            for (int pos = std::max(first, offset.pos); pos < end; ++pos)
+                callable(AxisGetResult(pos, offset.visualPos + static_cast<std::int64_t>(pos - offset.pos) * range.visibleElementVisualLength(), range.visibleElementVisualLength()));
+            if (end > last)
+                return;
+        }
+    }
+
+    bool addHideCount(int pos, int count, int delta)
+    {
+        if (pos < 0 || count < 0 || pos + count > length())
+            return false;
+        const std::size_t first = splitAt(pos);
+        const std::size_t last = splitAt(pos + count);
+        const bool valid = std::all_of(std::next(m_ranges.begin(), first), std::next(m_ranges.begin(), last),
+                                       [delta](const Range &range) { return range.hideCount() + delta >= 0; });
+        if (valid) {
+            for (std::size_t index = first; index < last; ++index)
+                m_ranges[index].setHideCount(m_ranges[index].hideCount() + delta);
+        }
+        fixRanges();
+        return valid;
+    }
+
+    // Replace count elements starting from pos with the elements of range.
+    // The ranges partially covered by the replaced span are split and all
+    // the ranges are fixed in a single pass
+    void replace(int pos, int count, Range range)
+    {
+        if (pos == length()) {
+            m_ranges.push_back(range);
+            fixRanges();
+            return;
+        }
+
+        const std::size_t first = rangeIndex(pos);
+        const std::size_t last = count > 0 ? rangeIndex(pos + count - 1) : first;
+        const Range &firstRange = m_ranges[first];
+        const Range &lastRange = m_ranges[last];
+        const int lastEnd = m_offsets[last].pos + lastRange.length();
+        const Range replacement[] = {
+            firstRange.resized(pos - m_offsets[first].pos),
+            range,
+            lastRange.resized(lastEnd - pos - count)
+        };
+
+        const auto it = std::next(m_ranges.begin(), first);
+        stdutils::replace(m_ranges, it, last - first + 1, std::begin(replacement), std::end(replacement));
+        fixRanges();
+    }
+
+    // Split the range containing pos so that a range starts at pos and
+    // return its index. Ranges before the returned index are not affected
+    std::size_t splitAt(int pos)
+    {
+        if (pos == length())
+            return m_ranges.size();
+        const std::size_t index = rangeIndex(pos);
+        const int start = m_offsets[index].pos;
+        if (pos == start)
+            return index;
+        const Range range = m_ranges[index];
+        m_ranges[index] = range.resized(pos - start);
+        m_ranges.insert(std::next(m_ranges.begin(), index + 1), range.resized(start + range.length() - pos));
+        updateOffsets();
+        return index + 1;
+    }
+
     void fixRanges()
     {
         /*
-        The current implementation is for efficient since fix the ranges
-        in place. On the otherhand is far more complex. This code
-        snippet shows the same code in a simple but less efficient way.
+        The current implementation is more efficient since it fixes the ranges
+        in place without allocating. This code snippet shows the same code in
+        a simple but less efficient way.
 
         std::vector<Range> ranges;
         ranges.reserve(m_ranges.size());
@@ -195,7 +353,7 @@ private:
                 continue;
             if (ranges.empty())
                 ranges.push_back(range);
-            else if (ranges.rbegin()->elementVisualLength() == range.elementVisualLength())
+            else if (ranges.rbegin()->hasSameElements(range))
                 ranges.rbegin()->resize(ranges.rbegin()->length() + range.length());
             else
                 ranges.push_back(range);
@@ -203,47 +361,61 @@ private:
         std::swap(m_ranges, ranges);
         */
 
-        auto first = m_ranges.begin();
-        auto last = m_ranges.end();
-        auto previous = m_ranges.end();
-        auto pivot = m_ranges.end();
-
-        // Find a pivot iterator for determing the first element
-        // from which the following should be removed
-        for (; first != last; ) {
-            if (first->empty()) {
-                pivot = first;
-                first = std::next(first);
-                break;
-            }
-            if (previous != m_ranges.end() && previous->elementVisualLength() == first->elementVisualLength()) {
-                previous->resize(previous->length() + first->length());
-                first->resize(0);
-            } else {
-                previous = first;
-                first = std::next(first);
-            }
+        // Compact the ranges in place: last is one past the last range kept
+        auto last = m_ranges.begin();
+        for (auto it = m_ranges.begin(); it != m_ranges.end(); ++it) {
+            if (it->empty())
+                continue;
+            if (last != m_ranges.begin() && std::prev(last)->hasSameElements(*it))
+                std::prev(last)->resize(std::prev(last)->length() + it->length());
+            else
+                *last++ = *it;
         }
 
-        for (; first != last; first = std::next(first)) {
-            if (first->empty()) {
-                // Do nothing
-            } else if (previous->elementVisualLength() == first->elementVisualLength()) {
-                previous->resize(previous->length() + first->length());
-                first->resize(0);
-            } else {
-                std::iter_swap(pivot, first);
-                previous = std::next(previous);
-                pivot = std::next(pivot);
-            }
+        // Remove all the element from last to end
+        m_ranges.erase(last, m_ranges.end());
+
+        updateOffsets();
+    }
+
+    // Recompute the cumulative number of elements and visual length
+    // preceding every range. The last entry holds the axis totals
+    void updateOffsets()
+    {
+        m_offsets.resize(m_ranges.size() + 1);
+        RangeOffset offset;
+        for (std::size_t i = 0; i < m_ranges.size(); ++i) {
+            m_offsets[i] = offset;
+            offset.pos += m_ranges[i].length();
+            offset.visualPos += m_ranges[i].visualLength();
         }
+        m_offsets.back() = offset;
+    }
 
-        // Remove all the element from pivot to end
-        if (pivot != m_ranges.end())
-            m_ranges.erase(pivot, last);
+    // Return the index of the range that contains the element at pos.
+    // The position must be in [0, length())
+    std::size_t rangeIndex(int pos) const
+    {
+        auto predicate = [](int value, const RangeOffset &offset) { return value < offset.pos; };
+        const auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), pos, predicate);
+        return std::distance(m_offsets.begin(), it) - 1;
+    }
 
-        return;
+    // Return the index of the range that contains the visual position.
+    // The visual position must be in [0, visualLength())
+    std::size_t visualRangeIndex(std::int64_t visualPos) const
+    {
+        auto predicate = [](std::int64_t value, const RangeOffset &offset) { return value < offset.visualPos; };
+        const auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), visualPos, predicate);
+        return std::distance(m_offsets.begin(), it) - 1;
     }
 
+    struct RangeOffset
+    {
+        int pos = 0;
+        std::int64_t visualPos = 0;
+    };
+
     std::vector<Range> m_ranges;
+    std::vector<RangeOffset> m_offsets = std::vector<RangeOffset>(1);
 };
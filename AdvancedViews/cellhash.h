@@ -0,0 +1,155 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+    CellHash maps a (row, column) pair to a non negative integer value.
+    Keys are packed in 64 bits and stored in a flat open addressed table with
+    linear probing. Removals shift back the following entries instead
+    of leaving tombstones, so lookups never degrade with churn.
+*/
+class CellHash
+{
+    friend class AdvancedViewsTest;
+
+public:
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    // Return the value associated to (row, column) or -1
+    int find(int row, int column) const
+    {
+        if (m_entries.empty())
+            return -1;
+        const std::uint64_t key = packKey(row, column);
+        for (std::size_t i = ideal(key); ; i = (i + 1) & mask()) {
+            const Entry &entry = m_entries[i];
+            if (entry.value == -1)
+                return -1;
+            if (entry.key == key)
+                return entry.value;
+        }
+    }
+
+    bool contains(int row, int column) const
+    {
+        return find(row, column) != -1;
+    }
+
+    // Associate value to (row, column) replacing any previous value
+    void insert(int row, int column, int value)
+    {
+        if ((m_size + 1) * 2 > m_entries.size())
+            rehash(m_entries.empty() ? 16 : m_entries.size() * 2);
+        const std::uint64_t key = packKey(row, column);
+        for (std::size_t i = ideal(key); ; i = (i + 1) & mask()) {
+            Entry &entry = m_entries[i];
+            if (entry.value == -1) {
+                entry.key = key;
+                entry.value = value;
+                ++m_size;
+                return;
+            }
+            if (entry.key == key) {
+                entry.value = value;
+                return;
+            }
+        }
+    }
+
+    bool remove(int row, int column)
+    {
+        if (m_entries.empty())
+            return false;
+        const std::uint64_t key = packKey(row, column);
+        std::size_t i = ideal(key);
+        for (; m_entries[i].key != key || m_entries[i].value == -1; i = (i + 1) & mask())
+            if (m_entries[i].value == -1)
+                return false;
+
+        // Shift back the following entries of the cluster that
+        // would not be reachable anymore from their ideal slot
+        for (std::size_t j = (i + 1) & mask(); m_entries[j].value != -1; j = (j + 1) & mask()) {
+            const std::size_t k = ideal(m_entries[j].key);
+            const bool reachable = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+            if (!reachable) {
+                m_entries[i] = m_entries[j];
+                i = j;
+            }
+        }
+        m_entries[i] = Entry();
+        --m_size;
+        return true;
+    }
+
+    void clear()
+    {
+        std::fill(m_entries.begin(), m_entries.end(), Entry());
+        m_size = 0;
+    }
+
+private:
+    struct Entry
+    {
+        std::uint64_t key = 0;
+        int value = -1;
+    };
+
+    static std::uint64_t packKey(int row, int column)
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(row)) << 32)
+                | static_cast<std::uint32_t>(column);
+    }
+
+    std::size_t mask() const
+    {
+        return m_entries.size() - 1;
+    }
+
+    // Fibonacci hashing spreads neighbouring cells over the whole table
+    std::size_t ideal(std::uint64_t key) const
+    {
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask();
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Entry> entries(capacity);
+        std::swap(entries, m_entries);
+        m_size = 0;
+        for (const Entry &entry : entries)
+            if (entry.value != -1)
+                insert(static_cast<int>(entry.key >> 32), static_cast<int>(entry.key & 0xFFFFFFFFu), entry.value);
+    }
+
+    std::vector<Entry> m_entries;
+    std::size_t m_size = 0;
+};
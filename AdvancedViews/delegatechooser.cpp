@@ -0,0 +1,137 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "delegatechooser.h"
+
+int DelegateChoice::column() const
+{
+    return m_column;
+}
+
+QVariant DelegateChoice::roleValue() const
+{
+    return m_roleValue;
+}
+
+QQmlComponent* DelegateChoice::delegate() const
+{
+    return m_delegate;
+}
+
+bool DelegateChoice::matches(int column, const QVariant &roleValue) const
+{
+    return (m_column == -1 || m_column == column)
+            && (!m_roleValue.isValid() || m_roleValue == roleValue);
+}
+
+void DelegateChoice::setColumn(int column)
+{
+    if (m_column == column)
+        return;
+
+    m_column = column;
+    emit columnChanged(m_column);
+    emit changed();
+}
+
+void DelegateChoice::setRoleValue(QVariant roleValue)
+{
+    if (m_roleValue == roleValue)
+        return;
+
+    m_roleValue = roleValue;
+    emit roleValueChanged(m_roleValue);
+    emit changed();
+}
+
+void DelegateChoice::setDelegate(QQmlComponent *delegate)
+{
+    if (m_delegate == delegate)
+        return;
+
+    m_delegate = delegate;
+    emit delegateChanged(m_delegate);
+    emit changed();
+}
+
+QString DelegateChooser::role() const
+{
+    return m_role;
+}
+
+QQmlListProperty<DelegateChoice> DelegateChooser::choices()
+{
+    return QQmlListProperty<DelegateChoice>(this, nullptr,
+                                            &DelegateChooser::appendChoice,
+                                            &DelegateChooser::choiceCount,
+                                            &DelegateChooser::choiceAt,
+                                            &DelegateChooser::clearChoices);
+}
+
+QQmlComponent *DelegateChooser::delegate(int column, const QVariant &roleValue) const
+{
+    for (DelegateChoice *choice : m_choices)
+        if (choice->matches(column, roleValue))
+            return choice->delegate();
+    return nullptr;
+}
+
+QList<QQmlComponent*> DelegateChooser::delegates() const
+{
+    QList<QQmlComponent*> result;
+    for (DelegateChoice *choice : m_choices)
+        if (choice->delegate())
+            result.append(choice->delegate());
+    return result;
+}
+
+void DelegateChooser::setRole(QString role)
+{
+    if (m_role == role)
+        return;
+
+    m_role = role;
+    emit roleChanged(m_role);
+    emit changed();
+}
+
+void DelegateChooser::appendChoice(QQmlListProperty<DelegateChoice> *list, DelegateChoice *choice)
+{
+    auto chooser = static_cast<DelegateChooser*>(list->object);
+    chooser->m_choices.append(choice);
+    connect(choice, &DelegateChoice::changed, chooser, &DelegateChooser::changed);
+    emit chooser->changed();
+}
+
+int DelegateChooser::choiceCount(QQmlListProperty<DelegateChoice> *list)
+{
+    return static_cast<DelegateChooser*>(list->object)->m_choices.size();
+}
+
+DelegateChoice *DelegateChooser::choiceAt(QQmlListProperty<DelegateChoice> *list, int index)
+{
+    return static_cast<DelegateChooser*>(list->object)->m_choices.at(index);
+}
+
+void DelegateChooser::clearChoices(QQmlListProperty<DelegateChoice> *list)
+{
+    auto chooser = static_cast<DelegateChooser*>(list->object);
+    for (DelegateChoice *choice : chooser->m_choices)
+        disconnect(choice, nullptr, chooser, nullptr);
+    chooser->m_choices.clear();
+    emit chooser->changed();
+}
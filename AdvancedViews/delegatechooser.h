@@ -0,0 +1,93 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQmlListProperty>
+#include <QVariant>
+
+// Delegate used for the cells matching both column and roleValue.
+// An unset column or roleValue matches any cell
+class DelegateChoice : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int column READ column WRITE setColumn NOTIFY columnChanged)
+    Q_PROPERTY(QVariant roleValue READ roleValue WRITE setRoleValue NOTIFY roleValueChanged)
+    Q_PROPERTY(QQmlComponent* delegate READ delegate WRITE setDelegate NOTIFY delegateChanged)
+
+public:
+    using QObject::QObject;
+
+    int column() const;
+    QVariant roleValue() const;
+    QQmlComponent* delegate() const;
+
+    bool matches(int column, const QVariant &roleValue) const;
+
+public slots:
+    void setColumn(int column);
+    void setRoleValue(QVariant roleValue);
+    void setDelegate(QQmlComponent *delegate);
+
+signals:
+    void columnChanged(int column);
+    void roleValueChanged(QVariant roleValue);
+    void delegateChanged(QQmlComponent *delegate);
+    void changed();
+
+private:
+    int m_column = -1;
+    QVariant m_roleValue;
+    QPointer<QQmlComponent> m_delegate;
+};
+
+// Pick the delegate of a cell among its choices. The first matching
+// choice wins. Choices compare their roleValue to the data of role
+class DelegateChooser : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString role READ role WRITE setRole NOTIFY roleChanged)
+    Q_PROPERTY(QQmlListProperty<DelegateChoice> choices READ choices)
+    Q_CLASSINFO("DefaultProperty", "choices")
+
+public:
+    using QObject::QObject;
+
+    QString role() const;
+    QQmlListProperty<DelegateChoice> choices();
+
+    QQmlComponent *delegate(int column, const QVariant &roleValue) const;
+    QList<QQmlComponent*> delegates() const;
+
+public slots:
+    void setRole(QString role);
+
+signals:
+    void roleChanged(QString role);
+    void changed();
+
+private:
+    static void appendChoice(QQmlListProperty<DelegateChoice> *list, DelegateChoice *choice);
+    static int choiceCount(QQmlListProperty<DelegateChoice> *list);
+    static DelegateChoice *choiceAt(QQmlListProperty<DelegateChoice> *list, int index);
+    static void clearChoices(QQmlListProperty<DelegateChoice> *list);
+
+    QString m_role;
+    QList<DelegateChoice*> m_choices;
+};
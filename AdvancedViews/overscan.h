@@ -0,0 +1,56 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <QPointF>
+#include <QRect>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace overscan {
+
+// Seconds of scrolling the overscan tries to anticipate
+constexpr double predictionInterval = 0.25;
+
+// Split buffer pixels before and after a span of an axis. At rest the buffer is
+// split evenly, while scrolling it moves toward the direction of travel
+// proportionally to the distance covered in the prediction interval
+inline std::pair<int, int> split(int buffer, double velocity)
+{
+    if (buffer <= 0)
+        return {0, 0};
+    const double distance = std::abs(velocity) * predictionInterval;
+    const int leading = static_cast<int>(std::clamp(distance, buffer / 2.0, static_cast<double>(buffer)));
+    const int trailing = buffer - leading;
+    return velocity < 0 ? std::make_pair(leading, trailing) : std::make_pair(trailing, leading);
+}
+
+// Return the visible area grown by the horizontal and vertical buffers
+inline QRect area(QRect visibleArea, int horizontalBuffer, int verticalBuffer, QPointF velocity)
+{
+    if (!visibleArea.isValid())
+        return visibleArea;
+    const auto horizontal = split(horizontalBuffer, velocity.x());
+    const auto vertical = split(verticalBuffer, velocity.y());
+    return visibleArea.adjusted(-horizontal.first, -vertical.first, horizontal.second, vertical.second);
+}
+
+}
@@ -0,0 +1,387 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/*
+    Permutation maps the logical positions of a sequence, the model
+    indexes, to its visual positions and back. Every element is a node
+    of two implicit treaps, one ordered by logical position and one by
+    visual position, sharing priorities. Positions are subtree ranks
+    found walking up through the parent links, so both lookups and every
+    insertion, removal and move cost logarithmic time. A whole new order
+    is built in linear time.
+
+    The identity is kept without nodes until a move or an order breaks it.
+*/
+class Permutation
+{
+    friend class AdvancedViewsTest;
+
+public:
+    int length() const
+    {
+        return m_length;
+    }
+
+    bool isIdentity() const
+    {
+        return m_identity;
+    }
+
+    // Reset to the identity of length elements
+    void reset(int length)
+    {
+        m_nodes.clear();
+        m_freeNodes.clear();
+        m_roots[Logical] = m_roots[Visual] = -1;
+        m_length = std::max(length, 0);
+        m_identity = true;
+    }
+
+    // Set the logical position of the element at every visual position.
+    // Returns false leaving the permutation untouched if order is not a
+    // permutation of [0, order.size())
+    bool setOrder(const std::vector<int> &order)
+    {
+        const int length = static_cast<int>(order.size());
+        std::vector<bool> seen(order.size(), false);
+        for (int logical : order) {
+            if (logical < 0 || logical >= length || seen[logical])
+                return false;
+            seen[logical] = true;
+        }
+        reset(length);
+        for (int visual = 0; visual < length; ++visual) {
+            if (order[visual] != visual) {
+                m_identity = false;
+                break;
+            }
+        }
+        if (m_identity)
+            return true;
+
+        // Node i holds logical position i
+        m_nodes.resize(order.size());
+        for (Node &node : m_nodes)
+            node.priority = m_random();
+        std::vector<int> sequence(order.size());
+        for (int i = 0; i < length; ++i)
+            sequence[i] = i;
+        m_roots[Logical] = build(Logical, sequence);
+        m_roots[Visual] = build(Visual, order);
+        return true;
+    }
+
+    // Return the logical position of the element at every visual position
+    std::vector<int> order() const
+    {
+        std::vector<int> result(m_length);
+        if (m_identity) {
+            for (int i = 0; i < m_length; ++i)
+                result[i] = i;
+            return result;
+        }
+        std::vector<int> logical(m_nodes.size());
+        int pos = 0;
+        forEachNode(Logical, m_roots[Logical], [&](int node) { logical[node] = pos++; });
+        pos = 0;
+        forEachNode(Visual, m_roots[Visual], [&](int node) { result[pos++] = logical[node]; });
+        return result;
+    }
+
+    int toVisual(int logical) const
+    {
+        if (logical < 0 || logical >= m_length)
+            return -1;
+        return m_identity ? logical : rank(Visual, nodeAt(Logical, logical));
+    }
+
+    int toLogical(int visual) const
+    {
+        if (visual < 0 || visual >= m_length)
+            return -1;
+        return m_identity ? visual : rank(Logical, nodeAt(Visual, visual));
+    }
+
+    // Insert count elements at the logical position logical and at the
+    // visual position visual
+    bool insert(int logical, int count, int visual)
+    {
+        if (logical < 0 || logical > m_length || visual < 0 || visual > m_length || count < 0)
+            return false;
+        if (m_identity && logical == visual) {
+            m_length += count;
+            return true;
+        }
+        materialize();
+        std::vector<int> sequence(count);
+        for (int &node : sequence)
+            node = createNode();
+        for (Tree tree : {Logical, Visual}) {
+            int left = -1, right = -1;
+            split(tree, m_roots[tree], tree == Logical ? logical : visual, left, right);
+            m_roots[tree] = merge(tree, merge(tree, left, build(tree, sequence)), right);
+        }
+        m_length += count;
+        return true;
+    }
+
+    // Remove count elements starting from the logical position logical
+    bool remove(int logical, int count)
+    {
+        if (logical < 0 || count < 0 || logical + count > m_length)
+            return false;
+        m_length -= count;
+        if (m_identity)
+            return true;
+        int left = -1, middle = -1, right = -1;
+        split(Logical, m_roots[Logical], logical, left, middle);
+        split(Logical, middle, count, middle, right);
+        m_roots[Logical] = merge(Logical, left, right);
+        forEachNode(Logical, middle, [this](int node) {
+            // Cut the node out of the visual tree at its rank
+            int left = -1, middle = -1, right = -1;
+            split(Visual, m_roots[Visual], rank(Visual, node), left, middle);
+            split(Visual, middle, 1, middle, right);
+            m_roots[Visual] = merge(Visual, left, right);
+            m_freeNodes.push_back(node);
+        });
+        return true;
+    }
+
+    // Move count elements starting from the logical position from before
+    // the one at to, keeping their visual positions
+    bool moveLogical(int from, int count, int to)
+    {
+        return move(Logical, from, count, to);
+    }
+
+    // Move count elements starting from the visual position from before
+    // the one at to, keeping their logical positions
+    bool moveVisual(int from, int count, int to)
+    {
+        return move(Visual, from, count, to);
+    }
+
+private:
+    enum Tree { Logical = 0, Visual = 1 };
+
+    struct Link
+    {
+        int left = -1;
+        int right = -1;
+        int parent = -1;
+        int size = 1;
+    };
+
+    struct Node
+    {
+        unsigned priority = 0;
+        Link links[2];
+    };
+
+    int size(Tree tree, int node) const
+    {
+        return node == -1 ? 0 : m_nodes[node].links[tree].size;
+    }
+
+    void update(Tree tree, int node)
+    {
+        Link &link = m_nodes[node].links[tree];
+        link.size = size(tree, link.left) + 1 + size(tree, link.right);
+        if (link.left != -1)
+            m_nodes[link.left].links[tree].parent = node;
+        if (link.right != -1)
+            m_nodes[link.right].links[tree].parent = node;
+    }
+
+    int nodeAt(Tree tree, int pos) const
+    {
+        int node = m_roots[tree];
+        while (node != -1) {
+            const Link &link = m_nodes[node].links[tree];
+            const int leftSize = size(tree, link.left);
+            if (pos < leftSize) {
+                node = link.left;
+            } else if (pos == leftSize) {
+                return node;
+            } else {
+                pos -= leftSize + 1;
+                node = link.right;
+            }
+        }
+        return -1;
+    }
+
+    int rank(Tree tree, int node) const
+    {
+        int result = size(tree, m_nodes[node].links[tree].left);
+        for (int parent = m_nodes[node].links[tree].parent; parent != -1; node = parent, parent = m_nodes[node].links[tree].parent) {
+            const Link &link = m_nodes[parent].links[tree];
+            if (link.right == node)
+                result += size(tree, link.left) + 1;
+        }
+        return result;
+    }
+
+    template<typename Callable>
+    void forEachNode(Tree tree, int root, Callable &&callable) const
+    {
+        std::vector<int> stack;
+        int node = root;
+        while (node != -1 || !stack.empty()) {
+            for (; node != -1; node = m_nodes[node].links[tree].left)
+                stack.push_back(node);
+            node = stack.back();
+            stack.pop_back();
+            const int right = m_nodes[node].links[tree].right;
+            callable(node);
+            node = right;
+        }
+    }
+
+    int createNode()
+    {
+        int node;
+        if (m_freeNodes.empty()) {
+            node = static_cast<int>(m_nodes.size());
+            m_nodes.emplace_back();
+        } else {
+            node = m_freeNodes.back();
+            m_freeNodes.pop_back();
+            m_nodes[node] = Node();
+        }
+        m_nodes[node].priority = m_random();
+        return node;
+    }
+
+    // Give nodes to the identity so that it can be broken
+    void materialize()
+    {
+        if (!m_identity)
+            return;
+        m_identity = false;
+        std::vector<int> sequence(m_length);
+        for (int &node : sequence)
+            node = createNode();
+        m_roots[Logical] = build(Logical, sequence);
+        m_roots[Visual] = build(Visual, sequence);
+    }
+
+    // Build the tree of the nodes of sequence in order in linear time
+    // keeping the right spine on a stack
+    int build(Tree tree, const std::vector<int> &sequence)
+    {
+        std::vector<int> spine;
+        for (int node : sequence) {
+            m_nodes[node].links[tree] = Link();
+            int last = -1;
+            while (!spine.empty() && m_nodes[spine.back()].priority < m_nodes[node].priority) {
+                last = spine.back();
+                spine.pop_back();
+                update(tree, last);
+            }
+            m_nodes[node].links[tree].left = last;
+            if (!spine.empty())
+                m_nodes[spine.back()].links[tree].right = node;
+            spine.push_back(node);
+        }
+        while (spine.size() > 1) {
+            update(tree, spine.back());
+            spine.pop_back();
+        }
+        if (spine.empty())
+            return -1;
+        update(tree, spine.back());
+        m_nodes[spine.back()].links[tree].parent = -1;
+        return spine.back();
+    }
+
+    // Split the tree in two trees holding respectively the first pos
+    // nodes and the remaining ones
+    void split(Tree tree, int node, int pos, int &left, int &right)
+    {
+        if (node == -1) {
+            left = right = -1;
+            return;
+        }
+        Link &link = m_nodes[node].links[tree];
+        if (pos <= size(tree, link.left)) {
+            int child = -1;
+            split(tree, link.left, pos, left, child);
+            link.left = child;
+            right = node;
+        } else {
+            int child = -1;
+            split(tree, link.right, pos - size(tree, link.left) - 1, child, right);
+            link.right = child;
+            left = node;
+        }
+        update(tree, node);
+        if (left != -1)
+            m_nodes[left].links[tree].parent = -1;
+        if (right != -1)
+            m_nodes[right].links[tree].parent = -1;
+    }
+
+    int merge(Tree tree, int left, int right)
+    {
+        if (left == -1)
+            return right;
+        if (right == -1)
+            return left;
+        if (m_nodes[left].priority > m_nodes[right].priority) {
+            const int child = merge(tree, m_nodes[left].links[tree].right, right);
+            m_nodes[left].links[tree].right = child;
+            update(tree, left);
+            return left;
+        } else {
+            const int child = merge(tree, left, m_nodes[right].links[tree].left);
+            m_nodes[right].links[tree].left = child;
+            update(tree, right);
+            return right;
+        }
+    }
+
+    bool move(Tree tree, int from, int count, int to)
+    {
+        if (from < 0 || count < 0 || to < 0 || from + count > m_length || to > m_length)
+            return false;
+        if (to >= from && to <= from + count) // Nothing to do
+            return true;
+        materialize();
+        int left = -1, middle = -1, right = -1;
+        split(tree, m_roots[tree], from, left, middle);
+        split(tree, middle, count, middle, right);
+        const int rest = merge(tree, left, right);
+        split(tree, rest, to > from ? to - count : to, left, right);
+        m_roots[tree] = merge(tree, merge(tree, left, middle), right);
+        return true;
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<int> m_freeNodes;
+    std::minstd_rand m_random;
+    int m_roots[2] = {-1, -1};
+    int m_length = 0;
+    bool m_identity = true;
+};
@@ -17,12 +17,16 @@
 
 #pragma once
 
+#include <cstdint>
+
 class Range
 {
 public:
-    constexpr Range(int numElements, int elementVisualLength)
+    constexpr Range(int numElements, int elementVisualLength, int hideCount = 0, bool fixed = false)
         : m_numElements(numElements)
         , m_elementVisualLength(elementVisualLength)
+        , m_hideCount(hideCount)
+        , m_fixed(fixed)
     {}
 
     Range(const Range &other) = default;
@@ -33,7 +37,17 @@ public:
     constexpr bool operator==(const Range &other) const
     {
         return m_numElements == other.m_numElements
-                && m_elementVisualLength == other.m_elementVisualLength;
+                && m_elementVisualLength == other.m_elementVisualLength
+                && m_hideCount == other.m_hideCount
+                && m_fixed == other.m_fixed;
+    }
+
+    // Whether the elements of both ranges can be merged in a single range
+    constexpr bool hasSameElements(const Range &other) const
+    {
+        return m_elementVisualLength == other.m_elementVisualLength
+                && m_hideCount == other.m_hideCount
+                && m_fixed == other.m_fixed;
     }
 
     constexpr bool empty() const
@@ -46,27 +60,64 @@ public:
         return m_numElements;
     }
 
+    // The visual length of the elements when they are shown
     constexpr int elementVisualLength() const
     {
         return m_elementVisualLength;
     }
 
-    constexpr int visualLength() const
+    // Hidden elements take no space but keep their visual length
+    // for when they are shown again
+    constexpr int visibleElementVisualLength() const
     {
-        return m_numElements * m_elementVisualLength;
+        return hidden() ? 0 : m_elementVisualLength;
     }
 
-    constexpr void resize(int size)
+    // The product is computed on 64 bits since ranges of millions of
+    // elements easily exceed the int range
+    constexpr std::int64_t visualLength() const
     {
-        m_numElements = size;
+        return static_cast<std::int64_t>(m_numElements) * visibleElementVisualLength();
+    }
+
+    // Number of hides not undone yet. Hides nest so that, for instance,
+    // expanding a group keeps hidden the rows of its collapsed subgroups
+    constexpr int hideCount() const
+    {
+        return m_hideCount;
+    }
+
+    constexpr bool hidden() const
+    {
+        return m_hideCount > 0;
     }
 
-    constexpr void setLength(int numElements)
+    constexpr void setHideCount(int hideCount)
     {
-        m_numElements = numElements;
+        m_hideCount = hideCount;
+    }
+
+    // Fixed elements were given a visual length of their own, while the
+    // others follow the default visual length of their axis
+    constexpr bool fixed() const
+    {
+        return m_fixed;
+    }
+
+    // Return a range of numElements elements like the ones of this range
+    constexpr Range resized(int numElements) const
+    {
+        return Range(numElements, m_elementVisualLength, m_hideCount, m_fixed);
+    }
+
+    constexpr void resize(int size)
+    {
+        m_numElements = size;
     }
 
 private:
     int m_numElements = 0;
     int m_elementVisualLength = 0;
+    int m_hideCount = 0;
+    bool m_fixed = false;
 };
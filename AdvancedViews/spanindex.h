@@ -0,0 +1,216 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <QRect>
+
+/*
+    SpanIndex stores disjoint rects of cell indexes, the column and the
+    row as the horizontal and vertical position of a QRect. The rects are
+    kept in a treap ordered by top row and then by left column where every
+    node caches the largest bottom row of its subtree. A query walks only
+    the subtrees that may hold rects crossing its rows, so it costs
+    logarithmic time plus the number of rects crossing those rows.
+*/
+class SpanIndex
+{
+    friend class AdvancedViewsTest;
+
+public:
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    void clear()
+    {
+        m_nodes.clear();
+        m_freeNodes.clear();
+        m_root = -1;
+        m_size = 0;
+    }
+
+    // Insert span removing the spans it intersects
+    void insert(QRect span)
+    {
+        if (!span.isValid())
+            return;
+        std::vector<QRect> overlapping;
+        forEachIntersecting(span, [&overlapping](QRect other) { overlapping.push_back(other); });
+        for (QRect other : overlapping)
+            remove(other.topLeft());
+        int left = -1, right = -1;
+        split(m_root, span.topLeft(), left, right);
+        m_root = merge(merge(left, createNode(span)), right);
+        ++m_size;
+    }
+
+    // Remove the span whose top left index is topLeft
+    bool remove(QPoint topLeft)
+    {
+        int left = -1, middle = -1, right = -1;
+        split(m_root, topLeft, left, middle);
+        split(middle, QPoint(topLeft.x() + 1, topLeft.y()), middle, right);
+        const bool found = middle != -1;
+        if (found) {
+            m_freeNodes.push_back(middle);
+            --m_size;
+        }
+        m_root = merge(left, right);
+        return found;
+    }
+
+    // Return the span containing the cell at row and column
+    std::optional<QRect> find(int row, int column) const
+    {
+        std::optional<QRect> result;
+        forEachIntersecting(QRect(column, row, 1, 1), [&result](QRect span) { result = span; });
+        return result;
+    }
+
+    // Invoke callable with every span ordered by top row and then by left column
+    template<typename Callable>
+    void forEach(Callable &&callable) const
+    {
+        const int max = std::numeric_limits<int>::max() - 1;
+        forEachIntersecting(m_root, QRect(QPoint(0, 0), QPoint(max, max)), callable);
+    }
+
+    // Invoke callable with every span intersecting indexes ordered by
+    // top row and then by left column
+    template<typename Callable>
+    void forEachIntersecting(QRect indexes, Callable &&callable) const
+    {
+        if (indexes.isValid())
+            forEachIntersecting(m_root, indexes, callable);
+    }
+
+private:
+    struct Node
+    {
+        QRect span;
+        unsigned priority = 0;
+        int left = -1;
+        int right = -1;
+        int maxBottom = 0;
+    };
+
+    static bool less(QPoint a, QPoint b)
+    {
+        return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+    }
+
+    void update(int node)
+    {
+        Node &n = m_nodes[node];
+        n.maxBottom = n.span.bottom();
+        if (n.left != -1)
+            n.maxBottom = std::max(n.maxBottom, m_nodes[n.left].maxBottom);
+        if (n.right != -1)
+            n.maxBottom = std::max(n.maxBottom, m_nodes[n.right].maxBottom);
+    }
+
+    template<typename Callable>
+    void forEachIntersecting(int node, QRect indexes, Callable &callable) const
+    {
+        // Subtrees ending above indexes are skipped as a whole
+        if (node == -1 || m_nodes[node].maxBottom < indexes.top())
+            return;
+        const Node &n = m_nodes[node];
+        forEachIntersecting(n.left, indexes, callable);
+        // Spans of the right subtree start below this one
+        if (n.span.top() > indexes.bottom())
+            return;
+        if (n.span.intersects(indexes))
+            callable(n.span);
+        forEachIntersecting(n.right, indexes, callable);
+    }
+
+    int createNode(QRect span)
+    {
+        int node;
+        if (m_freeNodes.empty()) {
+            node = static_cast<int>(m_nodes.size());
+            m_nodes.push_back(Node{span});
+        } else {
+            node = m_freeNodes.back();
+            m_freeNodes.pop_back();
+            m_nodes[node] = Node{span};
+        }
+        m_nodes[node].priority = m_random();
+        update(node);
+        return node;
+    }
+
+    // Split the tree in the spans starting before key and the remaining ones
+    void split(int node, QPoint key, int &left, int &right)
+    {
+        if (node == -1) {
+            left = right = -1;
+            return;
+        }
+        if (less(m_nodes[node].span.topLeft(), key)) {
+            int child = -1;
+            split(m_nodes[node].right, key, child, right);
+            m_nodes[node].right = child;
+            left = node;
+        } else {
+            int child = -1;
+            split(m_nodes[node].left, key, left, child);
+            m_nodes[node].left = child;
+            right = node;
+        }
+        update(node);
+    }
+
+    int merge(int left, int right)
+    {
+        if (left == -1)
+            return right;
+        if (right == -1)
+            return left;
+        if (m_nodes[left].priority > m_nodes[right].priority) {
+            const int child = merge(m_nodes[left].right, right);
+            m_nodes[left].right = child;
+            update(left);
+            return left;
+        } else {
+            const int child = merge(left, m_nodes[right].left);
+            m_nodes[right].left = child;
+            update(right);
+            return right;
+        }
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<int> m_freeNodes;
+    std::minstd_rand m_random;
+    int m_root = -1;
+    std::size_t m_size = 0;
+};
@@ -1,17 +1,21 @@
  #pragma once
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 
 namespace stdutils {
 
-auto reduce(const auto& container, const auto& callable, const auto initialValue) {
+template<typename Container, typename Callable, typename T>
+T reduce(const Container& container, const Callable& callable, const T initialValue) {
     auto result = initialValue;
     for (const auto& element : container)
         result += std::invoke(callable, element);
     return result;
 }
 
-void remove_if(auto& container, const auto& callable) {
+template<typename Container, typename Callable>
+void remove_if(Container& container, const Callable& callable) {
     auto first = std::begin(container);
     auto last = std::end(container);
     for (; first != last; ++first)
@@ -28,4 +32,18 @@ void remove_if(auto& container, const auto& callable) {
     container.erase(first, std::end(container));
 }
 
+// Replace count elements of container starting from first with the elements in [begin, end)
+template<typename Container, typename Iterator, typename InputIterator>
+void replace(Container& container, Iterator first, std::size_t count, InputIterator begin, InputIterator end) {
+    const auto size = static_cast<std::size_t>(std::distance(begin, end));
+    if (count >= size) {
+        const auto last = std::copy(begin, end, first);
+        container.erase(last, std::next(first, count));
+    } else {
+        const auto middle = std::next(begin, count);
+        std::copy(begin, middle, first);
+        container.insert(std::next(first, count), middle, end);
+    }
+}
+
 }
@@ -17,56 +17,266 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+
 #include <QRect>
 
-#include <axis.h>
 #include <cell.h>
+#include <spanindex.h>
+#include <treeaxis.h>
 
 class Table
 {
     friend class AdvancedViewsTest;
 
 public:
+    // The rects taken and returned by the table are relative to the origin,
+    // a visual position of the axes. Moving the origin near the area of
+    // interest keeps the rects in the int range however long the axes are
+    std::int64_t xOrigin() const { return m_xOrigin; }
+    std::int64_t yOrigin() const { return m_yOrigin; }
+
+    void setOrigin(std::int64_t xOrigin, std::int64_t yOrigin)
+    {
+        m_xOrigin = xOrigin;
+        m_yOrigin = yOrigin;
+    }
+
+    // Return the rect covered by the cells clamped to the int range
     QRect boundingRect() const
     {
-        return QRect(0, 0, m_xAxis.visualLength(), m_yAxis.visualLength());
+        return QRect(toRelative(0, m_xOrigin), toRelative(0, m_yOrigin),
+                     toRelative(m_xAxis.visualLength(), 0), toRelative(m_yAxis.visualLength(), 0));
     }
 
     std::vector<Cell> cellsInVisualRect(QRect rect) const
     {
-        rect = rect.intersected(boundingRect());
+        std::vector<Cell> result;
+        cellsInVisualRect(rect, result);
+        return result;
+    }
+
+    // Fill result with the cells in rect in row major order
+    void cellsInVisualRect(QRect rect, std::vector<Cell> &result) const
+    {
+        cellsInIndexRect(indexesInVisualRect(rect), result);
+    }
+
+    // Return the cell at row and column or nothing if it is out of the table
+    std::optional<Cell> cellAt(int row, int column) const
+    {
+        const std::optional<AxisGetResult> x = m_xAxis.get(column);
+        const std::optional<AxisGetResult> y = m_yAxis.get(row);
+        if (!x || !y)
+            return std::nullopt;
+        return Cell(row, column, QRect(toRelative(x->visualPos, m_xOrigin), toRelative(y->visualPos, m_yOrigin),
+                                       x->visualLength, y->visualLength));
+    }
+
+    // Return the columns and the rows of the cells in rect respectively
+    // as the horizontal and vertical span of a QRect
+    QRect indexesInVisualRect(QRect rect) const
+    {
         if (!rect.isValid())
-            return std::vector<Cell>();
-        const int columnMin = m_xAxis.visualGet(rect.left())->pos;
-        const int columnMax = m_xAxis.visualGet(rect.right() - 1)->pos;
-        const int rowMin = m_yAxis.visualGet(rect.top())->pos;
-        const int rowMax = m_yAxis.visualGet(rect.bottom() - 1)->pos;
+            return QRect();
 
-        std::vector<Cell> result;
-        for (int c = columnMin; c <= columnMax; ++c) {
-            for (int r = rowMin; r <= rowMax; ++r) {
-                const auto row = m_yAxis.get(r);
-                const auto column = m_xAxis.get(c);
-                result.emplace_back(row->pos, column->pos,
-                                    QRect(column->visualPos, row->visualPos,
-                                          column->visualLength, row->visualLength));
+        // The intersection with the cells is computed in visual positions
+        const std::int64_t left = std::max<std::int64_t>(m_xOrigin + rect.left(), 0);
+        const std::int64_t right = std::min<std::int64_t>(m_xOrigin + rect.right(), m_xAxis.visualLength() - 1);
+        const std::int64_t top = std::max<std::int64_t>(m_yOrigin + rect.top(), 0);
+        const std::int64_t bottom = std::min<std::int64_t>(m_yOrigin + rect.bottom(), m_yAxis.visualLength() - 1);
+        if (left > right || top > bottom)
+            return QRect();
+
+        const int columnMin = m_xAxis.visualGet(left)->pos;
+        const int columnMax = m_xAxis.visualGet(std::max(left, right - 1))->pos;
+        const int rowMin = m_yAxis.visualGet(top)->pos;
+        const int rowMax = m_yAxis.visualGet(std::max(top, bottom - 1))->pos;
+        return QRect(QPoint(columnMin, rowMin), QPoint(columnMax, rowMax));
+    }
+
+    // Fill result with the visible cells whose column and row are in
+    // indexes in row major order. Each axis is walked once and the capacity
+    // of result is reused between calls
+    void cellsInIndexRect(QRect indexes, std::vector<Cell> &result) const
+    {
+        result.clear();
+        if (!indexes.isValid())
+            return;
+
+        // The columns are computed for the first row and copied for the
+        // others. Hidden rows and columns are skipped, so the number of
+        // cells is not known in advance
+        bool firstRow = true;
+        std::size_t numColumns = 0;
+        m_yAxis.forEachVisible(indexes.top(), indexes.bottom(), [&](const AxisGetResult &row) {
+            if (firstRow) {
+                firstRow = false;
+                m_xAxis.forEachVisible(indexes.left(), indexes.right(), [&](const AxisGetResult &column) {
+                    result.emplace_back(row.pos, column.pos,
+                                        QRect(toRelative(column.visualPos, m_xOrigin), toRelative(row.visualPos, m_yOrigin),
+                                              column.visualLength, row.visualLength));
+                });
+                numColumns = result.size();
+                return;
             }
-        }
-        auto predicate = [](const Cell &l, const Cell &r){
-            if (l.row() < r.row())
-                return true;
-            if (l.column() < r.column())
-                return true;
+            for (std::size_t i = 0; i < numColumns; ++i) {
+                const int column = result[i].column();
+                const int x = result[i].x();
+                const int width = result[i].width();
+                result.emplace_back(row.pos, column, QRect(x, toRelative(row.visualPos, m_yOrigin), width, row.visualLength));
+            }
+        });
+    }
+
+    // Merge the cells of rowSpan rows and columnSpan columns starting from
+    // row and column. Spans intersecting the new one are removed, so a span
+    // of a single cell unmerges the whole span it falls in
+    bool setSpan(int row, int column, int rowSpan, int columnSpan)
+    {
+        if (row < 0 || column < 0 || rowSpan < 1 || columnSpan < 1)
             return false;
-        };
-        std::stable_sort(result.begin(), result.end(), predicate);
-        return result;
+        const QRect span(column, row, columnSpan, rowSpan);
+        if (rowSpan == 1 && columnSpan == 1) {
+            std::optional<QRect> other = m_spans.find(row, column);
+            if (other)
+                m_spans.remove(other->topLeft());
+        } else {
+            m_spans.insert(span);
+        }
+        return true;
+    }
+
+    void clearSpans()
+    {
+        m_spans.clear();
+    }
+
+    // Move the spans after count rows or columns inserted at pos along
+    // orientation. Insertions inside a span grow it
+    void insertSpanElements(Qt::Orientation orientation, int pos, int count)
+    {
+        mapSpans(orientation, [pos, count](int first, int last) -> std::optional<std::pair<int, int>> {
+            if (last < pos)
+                return std::make_pair(first, last);
+            if (first >= pos)
+                return std::make_pair(first + count, last + count);
+            return std::make_pair(first, last + count);
+        });
+    }
+
+    // Move the spans along with the rows or columns of orientation whose
+    // index i becomes map(i), or which are removed when it is -1. Spans
+    // shrink with the removal of some of their elements, and are dropped
+    // when their elements are not adjacent anymore or a single cell is left
+    void mapSpanElements(Qt::Orientation orientation, const std::function<int(int)> &map)
+    {
+        mapSpans(orientation, [&map](int first, int last) -> std::optional<std::pair<int, int>> {
+            int mappedFirst = std::numeric_limits<int>::max();
+            int mappedLast = -1;
+            int count = 0;
+            for (int i = first; i <= last; ++i) {
+                const int mapped = map(i);
+                if (mapped == -1)
+                    continue;
+                mappedFirst = std::min(mappedFirst, mapped);
+                mappedLast = std::max(mappedLast, mapped);
+                ++count;
+            }
+            if (count == 0 || mappedLast - mappedFirst + 1 != count)
+                return std::nullopt;
+            return std::make_pair(mappedFirst, mappedLast);
+        });
+    }
+
+    const SpanIndex &spans() const { return m_spans; }
+
+    // Return the indexes of the span holding the cell at row and column
+    std::optional<QRect> spanAt(int row, int column) const
+    {
+        return m_spans.find(row, column);
+    }
+
+    // Return the cell at the top left of span covering the cells of span
+    // that are in the table, or nothing if the top left cell is out of it
+    std::optional<Cell> spanCell(QRect span) const
+    {
+        const std::optional<AxisGetResult> left = m_xAxis.get(span.left());
+        const std::optional<AxisGetResult> top = m_yAxis.get(span.top());
+        if (!left || !top)
+            return std::nullopt;
+        const std::optional<AxisGetResult> right = m_xAxis.get(std::min(span.right(), m_xAxis.length() - 1));
+        const std::optional<AxisGetResult> bottom = m_yAxis.get(std::min(span.bottom(), m_yAxis.length() - 1));
+        const std::int64_t width = right->visualPos + right->visualLength - left->visualPos;
+        const std::int64_t height = bottom->visualPos + bottom->visualLength - top->visualPos;
+        return Cell(span.top(), span.left(), QRect(toRelative(left->visualPos, m_xOrigin), toRelative(top->visualPos, m_yOrigin),
+                                                   toRelative(width, 0), toRelative(height, 0)));
+    }
+
+    // Fill result with the merged cells of the spans intersecting rect,
+    // each once, ordered by row and then by column
+    void spansInVisualRect(QRect rect, std::vector<Cell> &result) const
+    {
+        spansInIndexRect(indexesInVisualRect(rect), result);
     }
 
-    Axis& xAxis() { return m_xAxis; }
-    Axis& yAxis() { return m_yAxis; }
+    void spansInIndexRect(QRect indexes, std::vector<Cell> &result) const
+    {
+        result.clear();
+        m_spans.forEachIntersecting(indexes, [&](QRect span) {
+            if (std::optional<Cell> cell = spanCell(span))
+                result.push_back(*cell);
+        });
+    }
+
+    TreeAxis& xAxis() { return m_xAxis; }
+    TreeAxis& yAxis() { return m_yAxis; }
+    const TreeAxis& xAxis() const { return m_xAxis; }
+    const TreeAxis& yAxis() const { return m_yAxis; }
 
 private:
-    Axis m_xAxis;
-    Axis m_yAxis;
+    // Replace the first and the last index along orientation of every span
+    // with the ones returned by map, dropping the spans it returns nothing for
+    template<typename Map>
+    void mapSpans(Qt::Orientation orientation, Map map)
+    {
+        if (m_spans.empty())
+            return;
+        std::vector<QRect> spans;
+        spans.reserve(m_spans.size());
+        m_spans.forEach([&spans](QRect span) { spans.push_back(span); });
+        m_spans.clear();
+        for (QRect span : spans) {
+            if (orientation == Qt::Horizontal) {
+                const std::optional<std::pair<int, int>> columns = map(span.left(), span.right());
+                if (!columns)
+                    continue;
+                span.setLeft(columns->first);
+                span.setRight(columns->second);
+            } else {
+                const std::optional<std::pair<int, int>> rows = map(span.top(), span.bottom());
+                if (!rows)
+                    continue;
+                span.setTop(rows->first);
+                span.setBottom(rows->second);
+            }
+            if (span.width() > 1 || span.height() > 1)
+                m_spans.insert(span);
+        }
+    }
+
+    static int toRelative(std::int64_t visualPos, std::int64_t origin)
+    {
+        const std::int64_t result = visualPos - origin;
+        return static_cast<int>(std::clamp<std::int64_t>(result, std::numeric_limits<int>::min(), std::numeric_limits<int>::max()));
+    }
+
+    TreeAxis m_xAxis;
+    TreeAxis m_yAxis;
+    SpanIndex m_spans;
+    std::int64_t m_xOrigin = 0;
+    std::int64_t m_yOrigin = 0;
 };
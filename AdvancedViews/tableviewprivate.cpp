@@ -16,28 +16,216 @@
 */
 
 #include "tableviewprivate.h"
+#include "overscan.h"
+#include "stdutils.h"
 
+#include <QBrush>
+#include <QDebug>
+#include <QPainter>
 #include <QQmlEngine>
-#include <iostream>
-#include <set>
-#include <unordered_set>
+#include <QQmlError>
+#include <QQuickWindow>
+#include <QSGImageNode>
+#include <QSGRectangleNode>
+#include <QtMath>
+
+#include <numeric>
 
 namespace
 {
 
-bool cellComparator(const Cell &c1, const Cell &c2)
+// Largest extent of the item. Longer axes are shown through a window of
+// this length whose origin follows the visible area, since the scene graph
+// loses pixel precision on large coordinates
+constexpr int maximumContentLength = 1 << 20;
+
+// Return the visual begin and end of the count elements starting from first
+std::pair<std::int64_t, std::int64_t> visualSpan(const TreeAxis &axis, int first, int count)
 {
-    if (c1.row() < c2.row())
-        return true;
-    if (c1.row() > c2.row())
-        return false;
-    if (c1.column() < c2.column())
-        return true;
-    if (c1.column() > c2.column())
-        return false;
-    return false;
+    const std::optional<AxisGetResult> begin = axis.get(first);
+    const std::optional<AxisGetResult> last = axis.get(first + count - 1);
+    return {begin->visualPos, last->visualPos + last->visualLength};
+}
+
+// Invoke callable with the strips of rect that are not covered by other.
+// Rects are in index space, so at most four strips are generated
+template<typename Callable>
+void forEachStrip(QRect rect, QRect other, Callable callable)
+{
+    if (!rect.isValid())
+        return;
+    const QRect intersection = rect.intersected(other);
+    if (!intersection.isValid()) {
+        callable(rect);
+        return;
+    }
+    if (rect.top() < intersection.top())
+        callable(QRect(QPoint(rect.left(), rect.top()), QPoint(rect.right(), intersection.top() - 1)));
+    if (intersection.bottom() < rect.bottom())
+        callable(QRect(QPoint(rect.left(), intersection.bottom() + 1), QPoint(rect.right(), rect.bottom())));
+    if (rect.left() < intersection.left())
+        callable(QRect(QPoint(rect.left(), intersection.top()), QPoint(intersection.left() - 1, intersection.bottom())));
+    if (intersection.right() < rect.right())
+        callable(QRect(QPoint(intersection.right() + 1, intersection.top()), QPoint(rect.right(), intersection.bottom())));
+}
+
+// Return the color held by value, which may be a brush, or fallback
+QColor colorData(const QVariant &value, Qt::GlobalColor fallback)
+{
+    if (value.userType() == QMetaType::QBrush)
+        return value.value<QBrush>().color();
+    const QColor color = value.value<QColor>();
+    return color.isValid() ? color : QColor(fallback);
+}
+
+// Identity of the texture of the text of a lightweight cell
+struct TextKey
+{
+    QString text;
+    QRgb color;
+    QSize size;
+
+    bool operator==(const TextKey &other) const
+    {
+        return text == other.text && color == other.color && size == other.size;
+    }
+};
+
+uint qHash(const TextKey &key, uint seed = 0)
+{
+    const quint64 size = static_cast<quint64>(key.size.width()) << 32 | static_cast<quint32>(key.size.height());
+    return ::qHash(key.text, seed) ^ ::qHash(key.color, seed) ^ ::qHash(size, seed);
+}
+
+// Root of the scene graph nodes of the lightweight cells. The background
+// of every cell is a rectangle node and its text an image node, since the
+// software backend supports neither custom geometries nor public glyph
+// nodes. The frozen cells have a layer of their own over the body
+class LightweightCellsNode : public QSGNode
+{
+public:
+    struct Layer
+    {
+        QSGNode *rectangles;
+        QSGNode *texts;
+    };
+
+    LightweightCellsNode()
+    {
+        for (Layer &layer : layers) {
+            layer.rectangles = new QSGNode();
+            layer.texts = new QSGNode();
+            appendChildNode(layer.rectangles);
+            appendChildNode(layer.texts);
+        }
+    }
+
+    ~LightweightCellsNode() override
+    {
+        for (const auto &texture : textures)
+            delete texture.first;
+    }
+
+    // Return the texture of text drawn with color over a cell of size. The
+    // textures of the texts of the previous frame are reused
+    QSGTexture *texture(QQuickWindow *window, const QString &text, const QColor &color, QSize size)
+    {
+        const qreal ratio = window->effectiveDevicePixelRatio();
+        const TextKey key{text, color.rgba(), size * ratio};
+        auto it = textures.find(key);
+        if (it == textures.end()) {
+            QImage image(key.size, QImage::Format_ARGB32_Premultiplied);
+            image.setDevicePixelRatio(ratio);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            painter.setPen(color);
+            painter.drawText(QRect(QPoint(), size), Qt::AlignCenter, text);
+            painter.end();
+            it = textures.insert(key, std::make_pair(window->createTextureFromImage(image), true));
+        }
+        it->second = true;
+        return it->first;
+    }
+
+    // Destroy the textures that were not used since the last call
+    void releaseUnusedTextures()
+    {
+        for (auto it = textures.begin(); it != textures.end(); ) {
+            if (it->second) {
+                it->second = false;
+                ++it;
+            } else {
+                delete it->first;
+                it = textures.erase(it);
+            }
+        }
+    }
+
+    std::array<Layer, 2> layers;
+    QHash<TextKey, std::pair<QSGTexture*, bool>> textures;
+};
+
+// Return the next child of parent, reusing child when there is one
+template<typename Node, typename Create>
+Node *nextChild(QSGNode *parent, QSGNode *&child, Create create)
+{
+    if (!child) {
+        Node *node = create();
+        parent->appendChildNode(node);
+        return node;
+    }
+    Node *node = static_cast<Node*>(child);
+    child = child->nextSibling();
+    return node;
+}
+
+// Destroy child and the children following it
+void removeChildren(QSGNode *parent, QSGNode *child)
+{
+    while (child) {
+        QSGNode *next = child->nextSibling();
+        parent->removeChildNode(child);
+        delete child;
+        child = next;
+    }
+}
+
+}
+
+void TableViewPrivateCellContext::setCell(int row, int column)
+{
+    if (m_row != row) {
+        m_row = row;
+        emit rowChanged(m_row);
+    }
+    if (m_column != column) {
+        m_column = column;
+        emit columnChanged(m_column);
+    }
+}
+
+void TableViewPrivateCellContext::setTreeState(int depth, bool hasChildren, bool expanded)
+{
+    if (m_depth != depth) {
+        m_depth = depth;
+        emit depthChanged(m_depth);
+    }
+    if (m_hasChildren != hasChildren) {
+        m_hasChildren = hasChildren;
+        emit hasChildrenChanged(m_hasChildren);
+    }
+    if (m_expanded != expanded) {
+        m_expanded = expanded;
+        emit expandedChanged(m_expanded);
+    }
 }
 
+void TableViewPrivateCellContext::setRole(const QString &name, const QVariant &value)
+{
+    // Writing an equal value would still reevaluate the bindings of the role
+    if (m_model.contains(name) && m_model.value(name) == value)
+        return;
+    m_model.insert(name, value);
 }
 
 TableViewPrivateElement::TableViewPrivateElement(TableViewPrivate &table, Cell cell)
@@ -51,17 +239,36 @@ TableViewPrivateElement::~TableViewPrivateElement()
     clearItem();
 }
 
-void TableViewPrivateElement::setCell(Cell c)
+bool TableViewPrivateElement::setCell(Cell c)
 {
+    // A reordered axis may show another model index at the same cell,
+    // while the elements before a change keep both and are left alone
+    const int row = m_table.modelRow(c.row());
+    const int column = m_table.modelColumn(c.column());
+    const bool indexChanged = !m_context || m_cellContext.row() != row || m_cellContext.column() != column;
+    if (!indexChanged && m_cell == c)
+        return false;
+
+    const bool rowChanged = m_cell.row() != c.row();
     m_cell = std::move(c);
-    if (m_context) {
-        m_context->setContextProperty("row", c.row());
-        m_context->setContextProperty("column", c.column());
+    if (m_context && indexChanged) {
+        m_cellContext.setCell(row, column);
+        updateData(QVector<int>());
+        updateTreeState();
     }
     if (m_item) {
-        m_item->setPosition(QPoint(m_cell.x(), m_cell.y()));
-        m_item->setSize(QSize(m_cell.width(), m_cell.height()));
+        placeItem(m_item.get());
+        if (rowChanged)
+            m_table.scheduleRowMeasurement(m_cell.row());
     }
+    return indexChanged;
+}
+
+void TableViewPrivateElement::placeItem(QQuickItem *item) const
+{
+    item->setPosition(QPoint(m_cell.x(), m_cell.y()));
+    item->setSize(QSize(m_cell.width(), m_cell.height()));
+    item->setZ(m_table.cellZ(m_cell.row(), m_cell.column()));
 }
 
 bool TableViewPrivateElement::visible() const
@@ -78,58 +285,183 @@ void TableViewPrivateElement::setVisible(bool visible)
         m_item->setVisible(m_visible);
 }
 
-void TableViewPrivateElement::createItem()
+void TableViewPrivateElement::createItem(QQmlComponent *delegate)
 {
-    Q_ASSERT(!m_incubator);
-    Q_ASSERT(!m_item);
-    Q_ASSERT(!m_context);
+    cancelIncubation();
 
+    // The items of every delegate share the context of the element
     QQmlContext *tableContext = QQmlEngine::contextForObject(&m_table);
-    m_context = std::make_unique<QQmlContext>(tableContext, nullptr);
-    m_context->setContextProperty("row", m_cell.row());
-    m_context->setContextProperty("column", m_cell.column());
+    if (!m_context) {
+        m_context = std::make_unique<QQmlContext>(tableContext, nullptr);
+        m_context->setContextObject(&m_cellContext);
+        m_cellContext.setCell(m_table.modelRow(m_cell.row()), m_table.modelColumn(m_cell.column()));
+        updateData(QVector<int>());
+        updateTreeState();
+    }
 
+    m_incubatingDelegate = delegate;
     m_incubator = std::make_unique<TableViewIncubator>(*this);
+    delegate->create(*m_incubator, m_context.get(), tableContext);
+}
 
-    m_table.cellDelegate()->create(*m_incubator, m_context.get(), tableContext);
+void TableViewPrivateElement::cancelIncubation()
+{
+    // Clearing destroys the object of an unfinished incubation
+    if (m_incubator)
+        m_incubator->clear();
+    m_incubator.reset();
+    m_incubatingDelegate.clear();
 }
 
 void TableViewPrivateElement::clearItem()
 {
+    // The objects of the incubator and the item live in the context
+    cancelIncubation();
     m_item.reset();
     m_context.reset();
-    m_incubator.reset();
+    m_delegate.clear();
+}
+
+void TableViewPrivateElement::updateData(const QVector<int> &roles)
+{
+    if (!m_context)
+        return;
+    const QHash<int, QByteArray> &roleNames = m_table.roleNames();
+    auto setRole = [this](int role, const QByteArray &name) {
+        m_cellContext.setRole(QString::fromUtf8(name), m_table.cellData(m_cell.row(), m_cell.column(), role));
+    };
+    if (roles.isEmpty()) {
+        for (auto it = roleNames.begin(); it != roleNames.end(); ++it)
+            setRole(it.key(), it.value());
+        return;
+    }
+    for (int role : roles) {
+        const auto it = roleNames.find(role);
+        if (it != roleNames.end())
+            setRole(role, it.value());
+    }
+}
+
+void TableViewPrivateElement::updateTreeState()
+{
+    if (!m_context)
+        return;
+    const int row = m_cell.row();
+    m_cellContext.setTreeState(m_table.rowDepth(row), m_table.rowHasChildren(row), m_table.isExpanded(row));
 }
 
 void TableViewPrivateElement::onIncubatorStatusChanged(QQmlIncubator::Status status)
 {
-    /* do nothing */
+    if (status != QQmlIncubator::Ready && status != QQmlIncubator::Error)
+        return;
+
+    // A failed delegate is not incubated again until its cell changes
+    m_delegate = m_incubatingDelegate;
+    m_incubatingDelegate.clear();
+    if (status == QQmlIncubator::Error) {
+        for (const QQmlError &error : m_incubator->errors())
+            qWarning() << error;
+        m_item.reset();
+        m_table.onIncubationFinished(this, false);
+        return;
+    }
+
+    QObject *object = m_incubator->object();
+    QQuickItem *item = qobject_cast<QQuickItem*>(object);
+    if (!item) {
+        qWarning() << "TableView: the delegate must be an Item";
+        delete object;
+    }
+    m_item.reset(item);
+    if (m_item) {
+        placeItem(m_item.get());
+        m_item->setVisible(m_visible);
+        QObject::connect(m_item.get(), &QQuickItem::implicitHeightChanged, [this] {
+            m_table.scheduleRowMeasurement(m_cell.row());
+        });
+    }
+    m_table.onIncubationFinished(this, m_item != nullptr);
 }
 
 void TableViewPrivateElement::onIncubatorSetInitialState(QObject *object)
 {
-    m_item.reset(qobject_cast<QQuickItem*>(object));
-    m_item->setParentItem(&m_table);
-    m_item->setX(m_cell.x());
-    m_item->setY(m_cell.y());
-    m_item->setWidth(m_cell.width());
-    m_item->setHeight(m_cell.height());
-    m_item->setZ(0);
-    m_item->setVisible(m_visible);
+    // The item is hidden until it is complete, while the current item of
+    // the element keeps showing
+    QQuickItem *item = qobject_cast<QQuickItem*>(object);
+    if (!item)
+        return;
+    item->setParentItem(&m_table);
+    placeItem(item);
+    item->setVisible(false);
 }
 
 TableViewPrivate::TableViewPrivate(QQuickItem *parent)
     : QQuickItem(parent)
 {
-    for (int i = 0; i < 1000; ++i) {
-        m_table.xAxis().append(100);
-        m_table.yAxis().append(100);
-    }
-    updateGeometry();
+    m_poolIdleTimer.setSingleShot(true);
+    m_poolIdleTimer.setInterval(5000);
+    connect(&m_poolIdleTimer, &QTimer::timeout, this, &TableViewPrivate::trimCache);
+
+    resetAxes();
 }
 
 TableViewPrivate::~TableViewPrivate() = default;
 
+DelegateChooser* TableViewPrivate::delegateChooser() const
+{
+    return m_delegateChooser;
+}
+
+QAbstractItemModel* TableViewPrivate::model() const
+{
+    return m_model;
+}
+
+int TableViewPrivate::rowCount() const
+{
+    return m_table.yAxis().length();
+}
+
+int TableViewPrivate::columnCount() const
+{
+    return m_table.xAxis().length();
+}
+
+int TableViewPrivate::defaultRowHeight() const
+{
+    return m_defaultRowHeight;
+}
+
+bool TableViewPrivate::autoRowHeight() const
+{
+    return m_autoRowHeight;
+}
+
+bool TableViewPrivate::tree() const
+{
+    return m_tree;
+}
+
+int TableViewPrivate::frozenRows() const
+{
+    return m_frozenRows;
+}
+
+int TableViewPrivate::frozenColumns() const
+{
+    return m_frozenColumns;
+}
+
+int TableViewPrivate::defaultColumnWidth() const
+{
+    return m_defaultColumnWidth;
+}
+
+bool TableViewPrivate::stretchLastColumn() const
+{
+    return m_stretchLastColumn;
+}
+
 QQmlComponent* TableViewPrivate::cellDelegate() const
 {
     return m_cellDelegate;
@@ -140,6 +472,267 @@ QRect TableViewPrivate::visibleArea() const
     return m_visibleArea;
 }
 
+QPointF TableViewPrivate::velocity() const
+{
+    return m_velocity;
+}
+
+bool TableViewPrivate::moving() const
+{
+    return m_moving;
+}
+
+bool TableViewPrivate::dragging() const
+{
+    return m_dragging;
+}
+
+QPointF TableViewPrivate::origin() const
+{
+    return QPointF(m_table.xOrigin(), m_table.yOrigin());
+}
+
+QSizeF TableViewPrivate::tableSize() const
+{
+    return m_tableSize;
+}
+
+int TableViewPrivate::horizontalCacheBuffer() const
+{
+    return m_horizontalCacheBuffer;
+}
+
+int TableViewPrivate::verticalCacheBuffer() const
+{
+    return m_verticalCacheBuffer;
+}
+
+int TableViewPrivate::incubationBudget() const
+{
+    return m_incubationBudget;
+}
+
+int TableViewPrivate::poolSize() const
+{
+    return m_poolSize;
+}
+
+int TableViewPrivate::poolIdleTimeout() const
+{
+    return m_poolIdleTimer.interval();
+}
+
+int TableViewPrivate::poolHighWaterMark() const
+{
+    return m_poolHighWaterMark;
+}
+
+bool TableViewPrivate::lightweightCells() const
+{
+    return m_lightweightCells;
+}
+
+QList<int> TableViewPrivate::delegateColumns() const
+{
+    return m_delegateColumns;
+}
+
+QQuickItem *TableViewPrivate::itemAt(int row, int column) const
+{
+    // row and column are model indexes
+    row = m_rowOrder.toVisual(row);
+    column = m_columnOrder.toVisual(column);
+    if (row == -1 || column == -1)
+        return nullptr;
+    TableViewPrivateElement *element = elementAt(row, column);
+    return element ? element->item() : nullptr;
+}
+
+void TableViewPrivate::setModel(QAbstractItemModel *model)
+{
+    if (m_model == model)
+        return;
+    if (m_model)
+        disconnect(m_model, nullptr, this, nullptr);
+    m_model = model;
+
+    // Only the top level rows and columns are shown, unless the view is a
+    // tree. Moves across parents are seen as removals or insertions
+    if (m_model) {
+        connect(m_model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &parent, int first, int last) {
+            if (m_tree)
+                insertTreeRows(parent, first, last);
+            else if (!parent.isValid())
+                insertElements(Qt::Vertical, first, last - first + 1);
+        });
+        connect(m_model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &parent, int first, int last) {
+            if (m_tree)
+                removeTreeRows(parent, first, last);
+            else if (!parent.isValid())
+                removeElements(Qt::Vertical, first, last - first + 1);
+        });
+        // Moves and layout changes lay the rows of a tree out again, and
+        // its expanded rows are found back through persistent indexes
+        connect(m_model, &QAbstractItemModel::rowsAboutToBeMoved, this, &TableViewPrivate::saveExpandedRows);
+        connect(m_model, &QAbstractItemModel::layoutAboutToBeChanged, this, &TableViewPrivate::saveExpandedRows);
+        connect(m_model, &QAbstractItemModel::layoutAboutToBeChanged, this, &TableViewPrivate::saveLayout);
+        connect(m_model, &QAbstractItemModel::rowsMoved, this, [this](const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row) {
+            if (m_tree) {
+                resetAxis(Qt::Vertical);
+                resetElements();
+            } else if (!parent.isValid() && !destination.isValid())
+                moveElements(Qt::Vertical, start, end - start + 1, row);
+            else if (!parent.isValid())
+                removeElements(Qt::Vertical, start, end - start + 1);
+            else if (!destination.isValid())
+                insertElements(Qt::Vertical, row, end - start + 1);
+        });
+        connect(m_model, &QAbstractItemModel::columnsInserted, this, [this](const QModelIndex &parent, int first, int last) {
+            if (!parent.isValid())
+                insertElements(Qt::Horizontal, first, last - first + 1);
+        });
+        connect(m_model, &QAbstractItemModel::columnsRemoved, this, [this](const QModelIndex &parent, int first, int last) {
+            if (!parent.isValid())
+                removeElements(Qt::Horizontal, first, last - first + 1);
+        });
+        connect(m_model, &QAbstractItemModel::columnsMoved, this, [this](const QModelIndex &parent, int start, int end, const QModelIndex &destination, int column) {
+            if (!parent.isValid() && !destination.isValid())
+                moveElements(Qt::Horizontal, start, end - start + 1, column);
+            else if (!parent.isValid())
+                removeElements(Qt::Horizontal, start, end - start + 1);
+            else if (!destination.isValid())
+                insertElements(Qt::Horizontal, column, end - start + 1);
+        });
+        connect(m_model, &QAbstractItemModel::dataChanged, this, &TableViewPrivate::onDataChanged);
+        // The rows and columns of a layout change keep their visual length
+        // and whether they are hidden, while their order and the spans,
+        // which are in view positions, are dropped
+        connect(m_model, &QAbstractItemModel::layoutChanged, this, [this] {
+            resetAxes();
+            restoreLayout();
+            resetElements();
+        });
+        connect(m_model, &QAbstractItemModel::modelReset, this, [this] {
+            m_roleNames = m_model->roleNames();
+            resetAxes();
+            resetElements();
+        });
+        connect(m_model, &QObject::destroyed, this, [this] {
+            m_roleNames.clear();
+            resetAxes();
+            resetElements();
+            emit modelChanged(nullptr);
+        });
+    }
+
+    m_roleNames = m_model ? m_model->roleNames() : QHash<int, QByteArray>();
+    resetAxes();
+    resetElements();
+    emit modelChanged(m_model);
+}
+
+// The counts set without a model are applied only while no model is set
+void TableViewPrivate::setRowCount(int rowCount)
+{
+    m_rowCount = std::max(0, rowCount);
+    if (m_model || m_rowCount == this->rowCount())
+        return;
+
+    resetAxis(Qt::Vertical);
+    resetElements();
+}
+
+void TableViewPrivate::setColumnCount(int columnCount)
+{
+    m_columnCount = std::max(0, columnCount);
+    if (m_model || m_columnCount == this->columnCount())
+        return;
+
+    resetAxis(Qt::Horizontal);
+    resetElements();
+}
+
+void TableViewPrivate::setDefaultRowHeight(int defaultRowHeight)
+{
+    // Rows without height would all lie at the same position
+    defaultRowHeight = std::max(1, defaultRowHeight);
+    if (m_defaultRowHeight == defaultRowHeight)
+        return;
+
+    m_defaultRowHeight = defaultRowHeight;
+    emit defaultRowHeightChanged(m_defaultRowHeight);
+    // Measured rows keep their height
+    m_table.yAxis().setDefaultVisualLength(m_defaultRowHeight);
+    // Elements keep their item and are resized in place
+    remapElements(Qt::Vertical, [](int index) { return index; });
+}
+
+void TableViewPrivate::setAutoRowHeight(bool autoRowHeight)
+{
+    if (m_autoRowHeight == autoRowHeight)
+        return;
+
+    m_autoRowHeight = autoRowHeight;
+    emit autoRowHeightChanged(m_autoRowHeight);
+    for (int row = m_liveIndexes.top(); row <= m_liveIndexes.bottom(); ++row)
+        scheduleRowMeasurement(row);
+}
+
+void TableViewPrivate::setTree(bool tree)
+{
+    if (m_tree == tree)
+        return;
+
+    m_tree = tree;
+    emit treeChanged(m_tree);
+    resetAxis(Qt::Vertical);
+    resetElements();
+}
+
+void TableViewPrivate::setFrozenRows(int frozenRows)
+{
+    frozenRows = std::max(0, frozenRows);
+    if (m_frozenRows == frozenRows)
+        return;
+
+    m_frozenRows = frozenRows;
+    emit frozenRowsChanged(m_frozenRows);
+    resetElements();
+}
+
+void TableViewPrivate::setFrozenColumns(int frozenColumns)
+{
+    frozenColumns = std::max(0, frozenColumns);
+    if (m_frozenColumns == frozenColumns)
+        return;
+
+    m_frozenColumns = frozenColumns;
+    emit frozenColumnsChanged(m_frozenColumns);
+    resetElements();
+}
+
+void TableViewPrivate::setDefaultColumnWidth(int defaultColumnWidth)
+{
+    defaultColumnWidth = std::max(1, defaultColumnWidth);
+    if (m_defaultColumnWidth == defaultColumnWidth)
+        return;
+
+    m_defaultColumnWidth = defaultColumnWidth;
+    emit defaultColumnWidthChanged(m_defaultColumnWidth);
+    m_table.xAxis().setDefaultVisualLength(m_defaultColumnWidth);
+    remapElements(Qt::Horizontal, [](int index) { return index; });
+}
+
+void TableViewPrivate::setStretchLastColumn(bool stretchLastColumn)
+{
+    if (m_stretchLastColumn == stretchLastColumn)
+        return;
+
+    m_stretchLastColumn = stretchLastColumn;
+    emit stretchLastColumnChanged(m_stretchLastColumn);
+    layoutStretchedElements();
+}
+
 void TableViewPrivate::setCellDelegate(QQmlComponent *cellDelegate)
 {
     if (m_cellDelegate == cellDelegate)
@@ -147,7 +740,21 @@ void TableViewPrivate::setCellDelegate(QQmlComponent *cellDelegate)
 
     m_cellDelegate = cellDelegate;
     emit cellDelegateChanged(m_cellDelegate);
-    onCellDelegateChanged();
+    onDelegatesChanged();
+}
+
+void TableViewPrivate::setDelegateChooser(DelegateChooser *delegateChooser)
+{
+    if (m_delegateChooser == delegateChooser)
+        return;
+
+    if (m_delegateChooser)
+        disconnect(m_delegateChooser, nullptr, this, nullptr);
+    m_delegateChooser = delegateChooser;
+    if (m_delegateChooser)
+        connect(m_delegateChooser, &DelegateChooser::changed, this, &TableViewPrivate::onDelegatesChanged);
+    emit delegateChooserChanged(m_delegateChooser);
+    onDelegatesChanged();
 }
 
 void TableViewPrivate::setVisibleArea(QRect visibleArea)
@@ -155,70 +762,1659 @@ void TableViewPrivate::setVisibleArea(QRect visibleArea)
     if (m_visibleArea == visibleArea)
         return;
 
+    // A stretched column follows the width of the visible area without
+    // changing the column axis
+    const bool stretch = m_stretchLastColumn && m_visibleArea.right() != visibleArea.right();
     m_visibleArea = visibleArea;
     emit visibleAreaChanged(m_visibleArea);
     onVisibleAreaChanged();
+    if (stretch)
+        layoutStretchedElements();
 }
 
-std::unique_ptr<TableViewPrivateElement> TableViewPrivate::getOrCreateElement(Cell cell)
+void TableViewPrivate::setVelocity(QPointF velocity)
 {
-    std::unique_ptr<TableViewPrivateElement> result;
-    if (m_cache.empty()) {
-        result = std::make_unique<TableViewPrivateElement>(*this, std::move(cell));
-        result->createItem();
-    } else {
-        result = std::move(m_cache.back());
-        m_cache.pop_back();
-        result->setCell(std::move(cell));
-        result->setVisible(true);
-    }
-    return result;
+    if (m_velocity == velocity)
+        return;
+
+    m_velocity = velocity;
+    emit velocityChanged(m_velocity);
+    onVisibleAreaChanged();
 }
 
-void TableViewPrivate::onVisibleAreaChanged()
+void TableViewPrivate::setMoving(bool moving)
+{
+    if (m_moving == moving)
+        return;
+
+    m_moving = moving;
+    emit movingChanged(m_moving);
+    if (!m_moving)
+        onVisibleAreaChanged();
+}
+
+void TableViewPrivate::setDragging(bool dragging)
 {
-    using CellSet = std::set<Cell, bool(*)(const Cell&, const Cell&)>;
+    if (m_dragging == dragging)
+        return;
 
-    CellSet visibleCells(&cellComparator);
-    const std::vector<Cell> visibleCellsVector = m_table.cellsInVisualRect(m_visibleArea);
-    visibleCells.insert(visibleCellsVector.begin(), visibleCellsVector.end());
+    m_dragging = dragging;
+    emit draggingChanged(m_dragging);
+    if (!m_dragging)
+        onVisibleAreaChanged();
+}
+
+void TableViewPrivate::setHorizontalCacheBuffer(int horizontalCacheBuffer)
+{
+    if (m_horizontalCacheBuffer == horizontalCacheBuffer)
+        return;
 
-    CellSet currentCells(&cellComparator);
-    for (const auto& e : m_elements)
-        currentCells.insert(e->cell());
+    m_horizontalCacheBuffer = horizontalCacheBuffer;
+    emit horizontalCacheBufferChanged(m_horizontalCacheBuffer);
+    onVisibleAreaChanged();
+}
 
-    // Remove elements that are not visibile anymore
-    auto isVisible = [&visibleCells] (const auto& e){ return visibleCells.find(e->cell()) != visibleCells.end(); };
-    const auto it = std::partition(m_elements.begin(), m_elements.end(), isVisible);
-    std::for_each(it, m_elements.end(), [](const auto& element) { element->setVisible(false); });
-    std::move(it, m_elements.end(), std::back_inserter(m_cache));
-    m_elements.erase(it, m_elements.end());
+void TableViewPrivate::setVerticalCacheBuffer(int verticalCacheBuffer)
+{
+    if (m_verticalCacheBuffer == verticalCacheBuffer)
+        return;
 
-    // Add new elements that become visible
-    for (const Cell& v : visibleCells)
-        if (currentCells.find(v) == currentCells.end())
-            m_elements.push_back(getOrCreateElement(v));
+    m_verticalCacheBuffer = verticalCacheBuffer;
+    emit verticalCacheBufferChanged(m_verticalCacheBuffer);
+    onVisibleAreaChanged();
 }
 
-void TableViewPrivate::onCellDelegateChanged()
+void TableViewPrivate::setIncubationBudget(int incubationBudget)
 {
-    for (const auto &element : m_elements)
-        element->clearItem();
-    if (m_cellDelegate.isNull())
+    if (m_incubationBudget == incubationBudget)
         return;
-    for (const auto &element : m_elements)
-        element->createItem();
+
+    m_incubationBudget = incubationBudget;
+    emit incubationBudgetChanged(m_incubationBudget);
 }
 
-void TableViewPrivate::updateGeometry()
+void TableViewPrivate::setPoolSize(int poolSize)
 {
-    auto rect = m_table.boundingRect();
-    setSize(rect.size());
+    if (m_poolSize == poolSize)
+        return;
+
+    m_poolSize = poolSize;
+    emit poolSizeChanged(m_poolSize);
+    if (m_poolSize >= 0)
+        trimPool(m_poolSize);
 }
 
-TableViewIncubator::TableViewIncubator(TableViewPrivateElement &element)
-    : m_element(element)
-{}
+void TableViewPrivate::setPoolIdleTimeout(int poolIdleTimeout)
+{
+    if (m_poolIdleTimer.interval() == poolIdleTimeout)
+        return;
+
+    m_poolIdleTimer.setInterval(poolIdleTimeout);
+    emit poolIdleTimeoutChanged(poolIdleTimeout);
+    if (poolIdleTimeout <= 0)
+        m_poolIdleTimer.stop();
+}
+
+void TableViewPrivate::setLightweightCells(bool lightweightCells)
+{
+    if (m_lightweightCells == lightweightCells)
+        return;
+
+    m_lightweightCells = lightweightCells;
+    setFlag(QQuickItem::ItemHasContents, m_lightweightCells);
+    emit lightweightCellsChanged(m_lightweightCells);
+    resetElements();
+}
+
+void TableViewPrivate::setDelegateColumns(QList<int> delegateColumns)
+{
+    std::sort(delegateColumns.begin(), delegateColumns.end());
+    if (m_delegateColumns == delegateColumns)
+        return;
+
+    m_delegateColumns = delegateColumns;
+    emit delegateColumnsChanged(m_delegateColumns);
+    if (m_lightweightCells)
+        resetElements();
+}
+
+bool TableViewPrivate::setSpan(int row, int column, int rowSpan, int columnSpan)
+{
+    if (!m_table.setSpan(row, column, rowSpan, columnSpan))
+        return false;
+    // Elements of the merged cells are recycled and the others resized in place
+    remapElements(Qt::Vertical, [](int row) { return row; });
+    return true;
+}
+
+void TableViewPrivate::clearSpans()
+{
+    if (m_table.spans().empty())
+        return;
+    m_table.clearSpans();
+    remapElements(Qt::Vertical, [](int row) { return row; });
+}
+
+bool TableViewPrivate::setRowOrder(const QList<int> &order)
+{
+    return setOrder(Qt::Vertical, order);
+}
+
+bool TableViewPrivate::setColumnOrder(const QList<int> &order)
+{
+    return setOrder(Qt::Horizontal, order);
+}
+
+bool TableViewPrivate::hideRows(int row, int count)
+{
+    return setHidden(Qt::Vertical, row, count, true);
+}
+
+bool TableViewPrivate::showRows(int row, int count)
+{
+    return setHidden(Qt::Vertical, row, count, false);
+}
+
+bool TableViewPrivate::hideColumns(int column, int count)
+{
+    return setHidden(Qt::Horizontal, column, count, true);
+}
+
+bool TableViewPrivate::showColumns(int column, int count)
+{
+    return setHidden(Qt::Horizontal, column, count, false);
+}
+
+bool TableViewPrivate::expand(int row)
+{
+    return setExpanded(row, true);
+}
+
+bool TableViewPrivate::collapse(int row)
+{
+    return setExpanded(row, false);
+}
+
+bool TableViewPrivate::isExpanded(int row) const
+{
+    return m_tree && row >= 0 && row < m_treeRows.size() && m_treeRows.node(row).expanded;
+}
+
+// Show position of the table at the top left of the visible area, or as
+// close as the size of the table allows. The origin is moved so that the
+// visible area lands in the middle of the content window
+void TableViewPrivate::scrollTo(QPointF position)
+{
+    auto scroll = [this](Qt::Orientation orientation, qreal position, int begin, int length) {
+        const std::int64_t end = std::max<std::int64_t>(0, axis(orientation).visualLength() - length);
+        const std::int64_t target = std::clamp<std::int64_t>(qRound64(position), 0, end);
+        setOrigin(orientation, std::clamp<std::int64_t>(target + length / 2 - maximumContentLength / 2, 0, maximumOrigin(orientation)));
+        return static_cast<int>(target - origin(orientation)) - begin;
+    };
+    const QPoint delta(scroll(Qt::Horizontal, position.x(), m_visibleArea.left(), m_visibleArea.width()),
+                       scroll(Qt::Vertical, position.y(), m_visibleArea.top(), m_visibleArea.height()));
+    m_visibleArea.translate(delta);
+    emit visibleAreaChanged(m_visibleArea);
+    emit contentShifted(delta);
+    // The elements are placed from the new origin before the ones of the
+    // new visible area are acquired
+    remapElements(Qt::Vertical, [](int index) { return index; });
+    onVisibleAreaChanged();
+}
+
+void TableViewPrivate::trimCache()
+{
+    trimPool(0);
+}
+
+const QHash<int, QByteArray> &TableViewPrivate::roleNames() const
+{
+    return m_roleNames;
+}
+
+void TableViewPrivate::scheduleRowMeasurement(int row)
+{
+    if (!m_autoRowHeight)
+        return;
+    m_rowsToMeasure.push_back(row);
+    scheduleFrame();
+}
+
+void TableViewPrivate::onIncubatingObjectCountChanged(int count)
+{
+    // The engine may also incubate objects of other views through this
+    // controller, which then have to be driven by the frames of this view
+    if (count > 0)
+        scheduleFrame();
+}
+
+void TableViewPrivate::onIncubationFinished(TableViewPrivateElement *element, bool ready)
+{
+    if (m_incubatingElement == element)
+        m_incubatingElement = nullptr;
+    scheduleFrame();
+    if (!ready)
+        return;
+
+    // The cell may have switched back to the delegate of the replaced item
+    // while the new one incubated
+    const Cell cell = element->cell();
+    if (element->delegate() != delegateFor(cell.row(), cell.column()))
+        scheduleIncubation(element);
+    scheduleRowMeasurement(cell.row());
+}
+
+int TableViewPrivate::cellZ(int row, int column) const
+{
+    // Frozen cells stack over the body and the corner over the headers
+    return (row < m_frozenRows ? 1 : 0) + (column < m_frozenColumns ? 1 : 0);
+}
+
+void TableViewPrivate::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    QQuickItem::itemChange(change, value);
+    if (change != ItemSceneChange)
+        return;
+
+    // Pending elements are incubated once per frame of the window. The view
+    // drives its own controller, installed only on an engine without one,
+    // and otherwise leaves the incubation to the controller of the engine
+    disconnect(m_afterAnimatingConnection);
+    releaseIncubationController();
+    if (!value.window)
+        return;
+    QQmlEngine *engine = qmlEngine(this);
+    if (engine && !engine->incubationController())
+        engine->setIncubationController(&m_incubationController);
+    m_afterAnimatingConnection = connect(value.window, &QQuickWindow::afterAnimating, this, &TableViewPrivate::onAfterAnimating);
+    scheduleFrame();
+}
+
+void TableViewPrivate::updatePolish()
+{
+    m_polishing = true;
+    applyDataChanges();
+    if (m_paintDirty) {
+        m_paintDirty = false;
+        updatePaintCells();
+        update();
+    }
+    m_polishing = false;
+}
+
+QQmlComponent *TableViewPrivate::delegateFor(int row, int column) const
+{
+    if (m_delegateChooser) {
+        const QString role = m_delegateChooser->role();
+        const QVariant roleValue = role.isEmpty() ? QVariant() : cellData(row, column, m_roleNames.key(role.toUtf8(), -1));
+        if (QQmlComponent *delegate = m_delegateChooser->delegate(modelColumn(column), roleValue))
+            return delegate;
+    }
+    return m_cellDelegate;
+}
+
+std::unique_ptr<TableViewPrivateElement> TableViewPrivate::getOrCreateElement(Cell cell)
+{
+    // Reuse an element with an item of the right delegate, or else one
+    // without item. Items of other delegates are never sacrificed
+    auto pool = m_pools.find(delegateFor(cell.row(), cell.column()));
+    if (pool == m_pools.end() || pool->second.empty())
+        pool = m_pools.find(nullptr);
+
+    std::unique_ptr<TableViewPrivateElement> result;
+    if (pool == m_pools.end() || pool->second.empty()) {
+        result = std::make_unique<TableViewPrivateElement>(*this, std::move(cell));
+    } else {
+        result = std::move(pool->second.back());
+        pool->second.pop_back();
+        // Data changes are dropped while an element is pooled, so an element
+        // coming back to its model index reads it again
+        if (!result->setCell(std::move(cell))) {
+            result->updateData(QVector<int>());
+            result->updateTreeState();
+            // Its row may have been reset to the default height meanwhile
+            if (result->item())
+                scheduleRowMeasurement(result->cell().row());
+        }
+        result->setVisible(true);
+    }
+    return result;
+}
+
+TableViewPrivateElement *TableViewPrivate::elementAt(int row, int column) const
+{
+    const int index = m_elementIndexes.find(row, column);
+    return index == -1 ? nullptr : m_elements[index].get();
+}
+
+// Return the cells of the elements in indexes. Rects spanning hidden rows
+// or columns may hold many more indexes than elements, in which case the
+// elements are scanned instead
+std::vector<Cell> TableViewPrivate::elementCells(QRect indexes) const
+{
+    std::vector<Cell> result;
+    if (!indexes.isValid())
+        return result;
+    if (static_cast<std::int64_t>(indexes.width()) * indexes.height() <= static_cast<std::int64_t>(m_elements.size())) {
+        for (int row = indexes.top(); row <= indexes.bottom(); ++row)
+            for (int column = indexes.left(); column <= indexes.right(); ++column)
+                if (const TableViewPrivateElement *element = elementAt(row, column))
+                    result.push_back(element->cell());
+    } else {
+        for (const auto &element : m_elements)
+            if (indexes.contains(QPoint(element->cell().column(), element->cell().row())))
+                result.push_back(element->cell());
+    }
+    return result;
+}
+
+void TableViewPrivate::acquireElement(Cell cell)
+{
+    m_elementIndexes.insert(cell.row(), cell.column(), static_cast<int>(m_elements.size()));
+    const QQmlComponent *delegate = delegateFor(cell.row(), cell.column());
+    m_elements.push_back(getOrCreateElement(placeCell(std::move(cell))));
+    if (m_elements.back()->delegate() != delegate)
+        scheduleIncubation(m_elements.back().get());
+}
+
+void TableViewPrivate::acquireElements(QRect indexes)
+{
+    // Only the strips of cells that are not live yet are walked
+    forEachStrip(indexes, m_liveIndexes, [this](QRect strip) {
+        m_table.cellsInIndexRect(strip, m_cells);
+        for (const Cell& cell : m_cells)
+            if (usesDelegate(cell.column()) && !m_elementIndexes.contains(cell.row(), cell.column())
+                    && !isMerged(cell.row(), cell.column()))
+                acquireElement(cell);
+    });
+}
+
+void TableViewPrivate::acquireSpanElements(QRect indexes)
+{
+    // Spans crossing indexes may start out of it
+    m_table.spans().forEachIntersecting(indexes, [this](QRect span) {
+        const std::optional<Cell> cell = m_table.cellAt(span.top(), span.left());
+        if (cell && usesDelegate(cell->column()) && !m_elementIndexes.contains(cell->row(), cell->column()))
+            acquireElement(*cell);
+    });
+}
+
+void TableViewPrivate::acquireLiveElements(QRect liveIndexes)
+{
+    // Visible cells go first so that they are queued for incubation
+    // before the cells predicted to become visible
+    for (QRect indexes : liveRects(m_visibleIndexes)) {
+        acquireElements(indexes);
+        acquireSpanElements(indexes);
+    }
+    for (QRect indexes : liveRects(liveIndexes)) {
+        acquireElements(indexes);
+        acquireSpanElements(indexes);
+    }
+}
+
+std::array<QRect, 4> TableViewPrivate::liveRects(QRect indexes) const
+{
+    // The frozen rows are live over the columns of indexes, the frozen
+    // columns over its rows and their corner whenever indexes is valid
+    std::array<QRect, 4> result = {indexes, QRect(), QRect(), QRect()};
+    const int frozenRows = std::min(m_frozenRows, rowCount());
+    const int frozenColumns = std::min(m_frozenColumns, columnCount());
+    if (!indexes.isValid())
+        return result;
+    if (frozenRows > 0)
+        result[1] = QRect(QPoint(indexes.left(), 0), QPoint(indexes.right(), frozenRows - 1));
+    if (frozenColumns > 0)
+        result[2] = QRect(QPoint(0, indexes.top()), QPoint(frozenColumns - 1, indexes.bottom()));
+    if (frozenRows > 0 && frozenColumns > 0)
+        result[3] = QRect(0, 0, frozenColumns, frozenRows);
+    return result;
+}
+
+bool TableViewPrivate::isLive(QRect liveIndexes, int row, int column) const
+{
+    // The top left cell of a span is live while any of its cells is
+    const std::optional<QRect> span = m_table.spans().empty() ? std::nullopt : m_table.spanAt(row, column);
+    if (span && span->topLeft() != QPoint(column, row))
+        return false;
+    const QRect cell = span ? *span : QRect(column, row, 1, 1);
+    for (QRect indexes : liveRects(liveIndexes))
+        if (indexes.intersects(cell))
+            return true;
+    return false;
+}
+
+bool TableViewPrivate::isMerged(int row, int column) const
+{
+    if (m_table.spans().empty())
+        return false;
+    const std::optional<QRect> span = m_table.spanAt(row, column);
+    return span && span->topLeft() != QPoint(column, row);
+}
+
+Cell TableViewPrivate::placeCell(Cell cell) const
+{
+    // The top left cell of a span covers all the cells of the span
+    int lastColumn = cell.column();
+    if (!m_table.spans().empty()) {
+        const std::optional<QRect> span = m_table.spanAt(cell.row(), cell.column());
+        if (span && span->topLeft() == QPoint(cell.column(), cell.row())) {
+            cell = *m_table.spanCell(*span);
+            lastColumn = span->right();
+        }
+    }
+
+    // Frozen cells keep their distance from the edges of the visible area
+    QRect rect = cell.rect();
+    if (cell.row() < m_frozenRows)
+        rect.moveTop(m_visibleArea.top() + static_cast<int>(cell.y() + m_table.yOrigin()));
+    if (cell.column() < m_frozenColumns)
+        rect.moveLeft(m_visibleArea.left() + static_cast<int>(cell.x() + m_table.xOrigin()));
+    // The last column reaches at least the right edge of the visible area
+    if (m_stretchLastColumn && lastColumn == columnCount() - 1)
+        rect.setRight(std::max(rect.right(), m_visibleArea.right()));
+    return Cell(cell.row(), cell.column(), rect);
+}
+
+void TableViewPrivate::layoutFrozenElements()
+{
+    const std::array<QRect, 4> rects = liveRects(m_liveIndexes);
+    for (std::size_t i = 1; i < rects.size(); ++i) {
+        m_table.cellsInIndexRect(rects[i], m_cells);
+        for (const Cell &cell : m_cells) {
+            TableViewPrivateElement *element = elementAt(cell.row(), cell.column());
+            const Cell placed = placeCell(cell);
+            if (element && !(element->cell() == placed))
+                element->setCell(placed);
+        }
+    }
+}
+
+void TableViewPrivate::layoutStretchedElements()
+{
+    for (const auto &element : m_elements) {
+        const std::optional<Cell> cell = m_table.cellAt(element->cell().row(), element->cell().column());
+        if (!cell)
+            continue;
+        const Cell placed = placeCell(*cell);
+        if (!(element->cell() == placed))
+            element->setCell(placed);
+    }
+    if (m_lightweightCells)
+        invalidatePaint();
+}
+
+void TableViewPrivate::releaseElement(int row, int column)
+{
+    const int index = m_elementIndexes.find(row, column);
+    if (index == -1)
+        return;
+    m_elementIndexes.remove(row, column);
+
+    // Fill the hole with the last element for keeping the vector compact
+    std::unique_ptr<TableViewPrivateElement> element = std::move(m_elements[index]);
+    if (static_cast<std::size_t>(index) + 1 != m_elements.size()) {
+        m_elements[index] = std::move(m_elements.back());
+        const Cell moved = m_elements[index]->cell();
+        m_elementIndexes.insert(moved.row(), moved.column(), index);
+    }
+    m_elements.pop_back();
+
+    recycleElement(std::move(element));
+}
+
+void TableViewPrivate::recycleElement(std::unique_ptr<TableViewPrivateElement> element)
+{
+    if (m_incubatingElement == element.get())
+        m_incubatingElement = nullptr;
+    element->cancelIncubation();
+    element->setVisible(false);
+    QQmlComponent *delegate = element->delegate();
+    const auto pool = m_pools.try_emplace(delegate);
+    if (pool.second && delegate)
+        connect(delegate, &QObject::destroyed, this, &TableViewPrivate::onDelegateDestroyed, Qt::UniqueConnection);
+    pool.first->second.push_back(std::move(element));
+}
+
+std::size_t TableViewPrivate::pooledCount() const
+{
+    std::size_t result = 0;
+    for (const auto &pool : m_pools)
+        result += pool.second.size();
+    return result;
+}
+
+// Polishing again from updatePolish would run within the same frame, so
+// that the polish is deferred to the end of the frame
+void TableViewPrivate::schedulePolish()
+{
+    if (!m_polishing) {
+        polish();
+        return;
+    }
+    m_polishDeferred = true;
+    scheduleFrame();
+}
+
+// Request another frame of the window. The update is queued so that a
+// request from the handlers of the current frame is not merged with it
+void TableViewPrivate::scheduleFrame()
+{
+    if (m_frameScheduled)
+        return;
+    m_frameScheduled = true;
+    QTimer::singleShot(0, this, [this] {
+        m_frameScheduled = false;
+        if (window())
+            window()->update();
+    });
+}
+
+void TableViewPrivate::onAfterAnimating()
+{
+    if (m_polishDeferred) {
+        m_polishDeferred = false;
+        polish();
+    }
+    // Incubation and measurement share the budget of the frame
+    QElapsedTimer timer;
+    timer.start();
+    incubatePendingElements(timer);
+    // Rows of the items that became ready take their height in this frame
+    applyRowMeasurements(timer);
+}
+
+void TableViewPrivate::scheduleIncubation(TableViewPrivateElement *element)
+{
+    if (element->scheduled())
+        return;
+    element->setScheduled(true);
+    m_pendingIncubations.push_back(element);
+    scheduleFrame();
+}
+
+void TableViewPrivate::startIncubation()
+{
+    TableViewPrivateElement *element = m_pendingIncubations.front();
+    m_pendingIncubations.erase(m_pendingIncubations.begin());
+    element->setScheduled(false);
+    const Cell cell = element->cell();
+    // A failure or a synchronous completion clears it within createItem
+    m_incubatingElement = element;
+    element->createItem(delegateFor(cell.row(), cell.column()));
+}
+
+void TableViewPrivate::incubatePendingElements(const QElapsedTimer &timer)
+{
+    QQmlEngine *engine = qmlEngine(this);
+    if (!engine)
+        return;
+    // The view drives its own controller only. Another controller of the
+    // engine incubates on its own schedule, to which only the next element
+    // is handed
+    const bool driving = engine->incubationController() == &m_incubationController;
+    if (!driving && !m_incubatingElement && m_pendingIncubations.empty())
+        return;
+
+    dropStalePendingIncubations();
+
+    // Visible cells are served before the ones in the cache area, whose
+    // incubation is dropped for a visible cell and started again later
+    auto isVisible = [this](const TableViewPrivateElement *element) {
+        return isLive(m_visibleIndexes, element->cell().row(), element->cell().column());
+    };
+    std::stable_partition(m_pendingIncubations.begin(), m_pendingIncubations.end(), isVisible);
+    if (m_incubatingElement && !m_pendingIncubations.empty() && !isVisible(m_incubatingElement)
+            && isVisible(m_pendingIncubations.front())) {
+        TableViewPrivateElement *element = m_incubatingElement;
+        m_incubatingElement = nullptr;
+        element->cancelIncubation();
+        scheduleIncubation(element);
+    }
+
+    // The controller makes at least one step per call so that a slow
+    // delegate still makes progress. The incubations of other views of the
+    // engine share the budget
+    do {
+        if (!m_incubatingElement && !m_pendingIncubations.empty())
+            startIncubation();
+        if (!driving || m_incubationController.incubatingObjectCount() == 0)
+            break;
+        m_incubationController.incubateFor(std::max<int>(1, m_incubationBudget - static_cast<int>(timer.elapsed())));
+    } while (timer.elapsed() < m_incubationBudget);
+
+    if (m_incubatingElement || !m_pendingIncubations.empty()
+            || (driving && m_incubationController.incubatingObjectCount() > 0))
+        scheduleFrame();
+}
+
+void TableViewPrivate::releaseIncubationController()
+{
+    QQmlEngine *engine = qmlEngine(this);
+    if (engine && engine->incubationController() == &m_incubationController)
+        engine->setIncubationController(nullptr);
+}
+
+void TableViewPrivate::dropStalePendingIncubations()
+{
+    // Drop the elements recycled before their incubation started and the
+    // ones whose item already matches their delegate
+    stdutils::remove_if(m_pendingIncubations, [this](TableViewPrivateElement *element) {
+        const Cell cell = element->cell();
+        QQmlComponent *delegate = delegateFor(cell.row(), cell.column());
+        if (delegate && element->delegate() != delegate && elementAt(cell.row(), cell.column()) == element)
+            return false;
+        element->setScheduled(false);
+        return true;
+    });
+}
+
+void TableViewPrivate::trimPool(std::size_t size)
+{
+    const std::size_t count = pooledCount();
+    if (count <= size)
+        return;
+
+    // Pooled elements may still be queued for incubation
+    dropStalePendingIncubations();
+
+    // Every pool is shrunk in proportion to its size, rounded down, and the
+    // rest of the excess is taken one element per pool so that exactly
+    // count - size elements go. Elements are reused from the back so the
+    // oldest ones are destroyed
+    const std::size_t excess = count - size;
+    std::size_t removed = 0;
+    std::vector<std::pair<std::vector<std::unique_ptr<TableViewPrivateElement>>*, std::size_t>> removals;
+    for (auto &pool : m_pools) {
+        const std::size_t share = pool.second.size() * excess / count;
+        removals.emplace_back(&pool.second, share);
+        removed += share;
+    }
+    for (auto &removal : removals) {
+        if (removed == excess)
+            break;
+        if (removal.second < removal.first->size()) {
+            ++removal.second;
+            ++removed;
+        }
+    }
+    for (const auto &removal : removals)
+        removal.first->erase(removal.first->begin(), std::next(removal.first->begin(), removal.second));
+}
+
+void TableViewPrivate::updatePool()
+{
+    if (m_poolSize >= 0)
+        trimPool(m_poolSize);
+    const int count = static_cast<int>(pooledCount());
+    if (count > m_poolHighWaterMark) {
+        m_poolHighWaterMark = count;
+        emit poolHighWaterMarkChanged(m_poolHighWaterMark);
+    }
+    if (count > 0 && m_poolIdleTimer.interval() > 0)
+        m_poolIdleTimer.start();
+}
+
+void TableViewPrivate::resetElements()
+{
+    for (auto &element : m_elements)
+        recycleElement(std::move(element));
+    m_elements.clear();
+    m_elementIndexes.clear();
+    m_liveIndexes = QRect();
+    onVisibleAreaChanged();
+    invalidatePaint();
+}
+
+bool TableViewPrivate::usesDelegate(int column) const
+{
+    return !m_lightweightCells || std::binary_search(m_delegateColumns.begin(), m_delegateColumns.end(), modelColumn(column));
+}
+
+// Return the data of the cell at row and column of the view
+QVariant TableViewPrivate::cellData(int row, int column, int role) const
+{
+    if (m_model.isNull())
+        return QVariant();
+    return m_model->data(modelIndex(row, column), role);
+}
+
+QModelIndex TableViewPrivate::modelIndex(int row, int column) const
+{
+    if (!m_tree)
+        return m_model->index(modelRow(row), modelColumn(column));
+    if (row < 0 || row >= m_treeRows.size())
+        return QModelIndex();
+
+    // The parents of a row of the tree are found from the top level down
+    const std::vector<int> path = m_treeRows.path(row);
+    QModelIndex parent;
+    for (std::size_t i = 0; i + 1 < path.size(); ++i)
+        parent = m_model->index(path[i], 0, parent);
+    return m_model->index(path.back(), modelColumn(column), parent);
+}
+
+int TableViewPrivate::modelRow(int row) const
+{
+    return m_rowOrder.isIdentity() ? row : m_rowOrder.toLogical(row);
+}
+
+int TableViewPrivate::modelColumn(int column) const
+{
+    return m_columnOrder.isIdentity() ? column : m_columnOrder.toLogical(column);
+}
+
+int TableViewPrivate::rowDepth(int row) const
+{
+    return m_tree && row >= 0 && row < m_treeRows.size() ? m_treeRows.node(row).depth : 0;
+}
+
+bool TableViewPrivate::rowHasChildren(int row) const
+{
+    return m_tree && row >= 0 && row < m_treeRows.size() && m_treeRows.node(row).descendants > 0;
+}
+
+void TableViewPrivate::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    // Changes of cells that are not live are dropped since their data is
+    // read again when they become live
+    if (topLeft.parent().isValid() && !m_tree)
+        return;
+
+    // A change of several rows or columns of a reordered axis is scattered
+    // over the view and is widened to the whole axis
+    auto toView = [](const Permutation &order, int first, int last) {
+        if (order.isIdentity())
+            return std::make_pair(first, last);
+        if (first == last)
+            return std::make_pair(order.toVisual(first), order.toVisual(first));
+        return std::make_pair(0, order.length() - 1);
+    };
+    // The change of siblings of a tree also covers the descendants between them
+    const std::pair<int, int> rows = m_tree ? std::make_pair(treeRow(topLeft), treeRow(bottomRight))
+                                            : toView(m_rowOrder, topLeft.row(), bottomRight.row());
+    if (rows.first == -1 || rows.second == -1)
+        return;
+    const std::pair<int, int> columns = toView(m_columnOrder, topLeft.column(), bottomRight.column());
+    const QRect changed(QPoint(columns.first, rows.first), QPoint(columns.second, rows.second));
+    QRect indexes;
+    for (QRect live : liveRects(m_liveIndexes))
+        indexes = indexes.united(changed.intersected(live));
+    if (!indexes.isValid())
+        return;
+
+    // Changes are coalesced until the next polish
+    m_dirtyIndexes = m_dirtyIndexes.united(indexes);
+    if (roles.isEmpty())
+        m_dirtyAllRoles = true;
+    for (int role : roles)
+        if (!m_dirtyRoles.contains(role))
+            m_dirtyRoles.append(role);
+    schedulePolish();
+}
+
+void TableViewPrivate::applyDataChanges()
+{
+    if (!m_dirtyIndexes.isValid())
+        return;
+    const QRect dirtyIndexes = m_dirtyIndexes;
+    const QVector<int> roles = m_dirtyAllRoles ? QVector<int>() : m_dirtyRoles;
+    m_dirtyIndexes = QRect();
+    m_dirtyRoles.clear();
+    m_dirtyAllRoles = false;
+
+    // A change of the role of the delegate chooser may switch delegates
+    const QString chooserRole = m_delegateChooser ? m_delegateChooser->role() : QString();
+    const bool delegatesChanged = !chooserRole.isEmpty()
+            && (roles.isEmpty() || roles.contains(m_roleNames.key(chooserRole.toUtf8(), -1)));
+
+    if (m_lightweightCells) {
+        for (QRect visible : liveRects(m_visibleIndexes))
+            if (dirtyIndexes.intersects(visible))
+                invalidatePaint();
+    }
+    // The live rects may overlap, in which case a few elements are refreshed twice
+    for (QRect live : liveRects(m_liveIndexes)) {
+        for (const Cell &cell : elementCells(dirtyIndexes.intersected(live))) {
+            TableViewPrivateElement *element = elementAt(cell.row(), cell.column());
+            element->updateData(roles);
+            if (delegatesChanged && element->delegate() != delegateFor(cell.row(), cell.column()))
+                scheduleIncubation(element);
+        }
+    }
+}
+
+// Measure the rows left to measure until the budget of the frame is spent,
+// and the others in the next frames. At least one row is measured per frame
+void TableViewPrivate::applyRowMeasurements(const QElapsedTimer &timer)
+{
+    if (m_rowsToMeasure.empty())
+        return;
+    std::sort(m_rowsToMeasure.begin(), m_rowsToMeasure.end());
+    m_rowsToMeasure.erase(std::unique(m_rowsToMeasure.begin(), m_rowsToMeasure.end()), m_rowsToMeasure.end());
+
+    // A row is as high as the tallest of its live items. Rows never
+    // measured keep defaultRowHeight as an estimate
+    bool changed = false;
+    auto next = m_rowsToMeasure.begin();
+    for (; next != m_rowsToMeasure.end(); ++next) {
+        if (next != m_rowsToMeasure.begin() && timer.elapsed() >= m_incubationBudget)
+            break;
+        const int row = *next;
+        int height = 0;
+        auto measure = [&](int firstColumn, int lastColumn) {
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                const TableViewPrivateElement *element = elementAt(row, column);
+                if (element && element->item())
+                    height = std::max(height, qCeil(element->item()->implicitHeight()));
+            }
+        };
+        measure(0, std::min(m_frozenColumns, m_liveIndexes.left()) - 1);
+        measure(m_liveIndexes.left(), m_liveIndexes.right());
+        const std::optional<AxisGetResult> current = m_table.yAxis().get(row);
+        if (height <= 0 || !current || current->visualLength == height)
+            continue;
+        m_table.yAxis().setVisualLength(row, height);
+        changed = true;
+
+        // Rows above the top visible one must not move the visible content
+        const std::int64_t visibleBegin = origin(Qt::Vertical) + m_visibleArea.top();
+        if (current->visualPos + current->visualLength <= visibleBegin)
+            shiftContent(Qt::Vertical, height - current->visualLength);
+    }
+    m_rowsToMeasure.erase(m_rowsToMeasure.begin(), next);
+    if (!m_rowsToMeasure.empty())
+        scheduleFrame();
+
+    // The elements of the rows that became live are incubated in the next frames
+    if (changed)
+        remapElements(Qt::Vertical, [](int index) { return index; });
+}
+
+TreeAxis &TableViewPrivate::axis(Qt::Orientation orientation)
+{
+    return orientation == Qt::Horizontal ? m_table.xAxis() : m_table.yAxis();
+}
+
+// Hide or show count elements starting from first in view positions
+bool TableViewPrivate::setHidden(Qt::Orientation orientation, int first, int count, bool hidden)
+{
+    if (count <= 0 || first < 0 || first + count > axis(orientation).length())
+        return false;
+
+    // Only the part of the elements before the visible area moves it
+    const std::int64_t visibleBegin = origin(orientation) + (orientation == Qt::Horizontal ? m_visibleArea.left() : m_visibleArea.top());
+    auto lengthBefore = [&] {
+        const std::pair<std::int64_t, std::int64_t> span = visualSpan(axis(orientation), first, count);
+        return std::max<std::int64_t>(0, std::min(span.second, visibleBegin) - span.first);
+    };
+    const std::int64_t before = lengthBefore();
+    if (!(hidden ? axis(orientation).hide(first, count) : axis(orientation).show(first, count)))
+        return false;
+    const std::int64_t shift = lengthBefore() - before;
+    if (shift != 0)
+        shiftContent(orientation, shift);
+
+    remapElements(orientation, [](int index) { return index; });
+    return true;
+}
+
+Permutation &TableViewPrivate::order(Qt::Orientation orientation)
+{
+    return orientation == Qt::Horizontal ? m_columnOrder : m_rowOrder;
+}
+
+// Show the model indexes of modelIndexes in this order along the axis
+// of orientation, or in the order of the model if it is empty. Elements
+// follow their model index and the visual lengths move with them
+bool TableViewPrivate::setOrder(Qt::Orientation orientation, const QList<int> &modelIndexes)
+{
+    // The rows of a tree follow the depth first order of the model
+    if (orientation == Qt::Vertical && m_tree)
+        return false;
+
+    Permutation &order = this->order(orientation);
+    const int length = order.length();
+    std::vector<int> logical(modelIndexes.begin(), modelIndexes.end());
+    if (logical.empty()) {
+        logical.resize(length);
+        std::iota(logical.begin(), logical.end(), 0);
+    }
+    Permutation next;
+    if (static_cast<int>(logical.size()) != length || !next.setOrder(logical))
+        return false;
+
+    // Pending data changes refer to the previous order
+    applyDataChanges();
+    const std::vector<int> previous = order.order();
+    std::vector<int> previousVisual(length);
+    std::vector<int> nextVisual(length);
+    for (int visual = 0; visual < length; ++visual) {
+        previousVisual[previous[visual]] = visual;
+        nextVisual[logical[visual]] = visual;
+    }
+    std::vector<int> from(length);
+    for (int visual = 0; visual < length; ++visual)
+        from[visual] = previousVisual[logical[visual]];
+    axis(orientation).permute(from);
+    order = std::move(next);
+
+    auto map = [&previous, &nextVisual](int index) {
+        return nextVisual[previous[index]];
+    };
+    m_table.mapSpanElements(orientation, map);
+    remapElements(orientation, map);
+    return true;
+}
+
+int TableViewPrivate::defaultVisualLength(Qt::Orientation orientation) const
+{
+    return orientation == Qt::Horizontal ? m_defaultColumnWidth : m_defaultRowHeight;
+}
+
+void TableViewPrivate::emitCountChanged(Qt::Orientation orientation)
+{
+    if (orientation == Qt::Horizontal)
+        emit columnCountChanged(columnCount());
+    else
+        emit rowCountChanged(rowCount());
+}
+
+// Rebuild the axis of orientation from the model, or from the count set
+// without one, with every element at the default length in the model order.
+// The spans are dropped with the positions they refer to
+void TableViewPrivate::resetAxis(Qt::Orientation orientation)
+{
+    m_table.clearSpans();
+    // Rows waiting for their measurement are gone, and the items shown
+    // again are measured anew
+    if (orientation == Qt::Vertical)
+        m_rowsToMeasure.clear();
+    if (orientation == Qt::Vertical && m_tree && m_model) {
+        resetTreeRows();
+    } else {
+        const int oldLength = axis(orientation).length();
+        const int length = orientation == Qt::Horizontal ? (m_model ? m_model->columnCount() : m_columnCount)
+                                                         : (m_model ? m_model->rowCount() : m_rowCount);
+        // The hide counts of the rows of a tree are dropped with them
+        if (orientation == Qt::Vertical)
+            m_treeRows.clear();
+        // Each axis is made of a single range whatever its length
+        axis(orientation).removeAt(0, oldLength);
+        axis(orientation).insertAt(0, Range(length, defaultVisualLength(orientation)));
+        order(orientation).reset(length);
+        if (length != oldLength)
+            emitCountChanged(orientation);
+    }
+    clampOrigin(orientation);
+}
+
+void TableViewPrivate::resetAxes()
+{
+    resetAxis(Qt::Horizontal);
+    resetAxis(Qt::Vertical);
+}
+
+void TableViewPrivate::clampOrigin(Qt::Orientation orientation)
+{
+    setOrigin(orientation, std::min(origin(orientation), maximumOrigin(orientation)));
+    updateGeometry();
+}
+
+// Keep the model indexes of the rows and columns which are fixed or hidden,
+// so that they are found after a layout change
+void TableViewPrivate::saveLayout()
+{
+    m_savedLayout.clear();
+    if (m_tree || !m_model)
+        return;
+    for (Qt::Orientation orientation : {Qt::Horizontal, Qt::Vertical}) {
+        int pos = 0;
+        for (const Range &range : axis(orientation).ranges()) {
+            if (range.fixed() || range.hidden()) {
+                for (int i = pos; i < pos + range.length(); ++i) {
+                    const int model = orientation == Qt::Horizontal ? modelColumn(i) : modelRow(i);
+                    const QModelIndex index = orientation == Qt::Horizontal ? m_model->index(0, model) : m_model->index(model, 0);
+                    if (index.isValid())
+                        m_savedLayout.push_back({orientation, index, range.fixed() ? range.elementVisualLength() : -1, range.hideCount()});
+                }
+            }
+            pos += range.length();
+        }
+    }
+}
+
+void TableViewPrivate::restoreLayout()
+{
+    for (const SavedElement &element : m_savedLayout) {
+        if (!element.index.isValid())
+            continue;
+        const int pos = element.orientation == Qt::Horizontal ? element.index.column() : element.index.row();
+        if (element.visualLength != -1)
+            axis(element.orientation).setVisualLength(pos, element.visualLength);
+        for (int i = 0; i < element.hideCount; ++i)
+            axis(element.orientation).hide(pos, 1);
+    }
+    m_savedLayout.clear();
+    clampOrigin(Qt::Horizontal);
+    clampOrigin(Qt::Vertical);
+}
+
+void TableViewPrivate::insertElements(Qt::Orientation orientation, int model, int count)
+{
+    insertElements(orientation, model, {Range(count, defaultVisualLength(orientation))});
+}
+
+// Insert the elements of ranges, which may be hidden, at the model index model
+void TableViewPrivate::insertElements(Qt::Orientation orientation, int model, const std::vector<Range> &ranges)
+{
+    int count = 0;
+    for (const Range &range : ranges)
+        count += range.length();
+
+    // Elements inserted in a reordered axis go before the element of the
+    // model index they are inserted at
+    Permutation &order = this->order(orientation);
+    const int first = model < order.length() ? order.toVisual(model) : order.length();
+    if (count <= 0 || first == -1 || !order.insert(model, count, first))
+        return;
+    int pos = first;
+    for (const Range &range : ranges) {
+        axis(orientation).insertAt(pos, range);
+        pos += range.length();
+    }
+    m_table.insertSpanElements(orientation, first, count);
+    emitCountChanged(orientation);
+
+    // Elements inserted before the visible area push it forward
+    const std::int64_t visibleBegin = origin(orientation) + (orientation == Qt::Horizontal ? m_visibleArea.left() : m_visibleArea.top());
+    const std::pair<std::int64_t, std::int64_t> span = visualSpan(axis(orientation), first, count);
+    if (span.first < visibleBegin)
+        shiftContent(orientation, span.second - span.first);
+
+    remapElements(orientation, [first, count](int index) {
+        return index >= first ? index + count : index;
+    });
+}
+
+void TableViewPrivate::removeElements(Qt::Orientation orientation, int model, int count)
+{
+    if (count <= 0 || model < 0 || model + count > axis(orientation).length())
+        return;
+
+    // The removed elements are scattered over a reordered axis. Their runs
+    // are removed from the last one so that the positions of the others hold
+    Permutation &order = this->order(orientation);
+    std::vector<int> removed(count);
+    for (int i = 0; i < count; ++i)
+        removed[i] = order.isIdentity() ? model + i : order.toVisual(model + i);
+    std::sort(removed.begin(), removed.end());
+    order.remove(model, count);
+
+    // Only the part of the removed elements before the visible area pulls it back
+    const std::int64_t visibleBegin = origin(orientation) + (orientation == Qt::Horizontal ? m_visibleArea.left() : m_visibleArea.top());
+    std::int64_t shift = 0;
+    for (std::size_t end = removed.size(); end > 0; ) {
+        std::size_t begin = end - 1;
+        while (begin > 0 && removed[begin - 1] + 1 == removed[begin])
+            --begin;
+        const int first = removed[begin];
+        const int runCount = static_cast<int>(end - begin);
+        const std::pair<std::int64_t, std::int64_t> span = visualSpan(axis(orientation), first, runCount);
+        shift += std::max<std::int64_t>(0, std::min(span.second, visibleBegin) - span.first);
+        axis(orientation).removeAt(first, runCount);
+        end = begin;
+    }
+    auto map = [&removed](int index) {
+        const auto it = std::lower_bound(removed.begin(), removed.end(), index);
+        if (it != removed.end() && *it == index)
+            return -1;
+        return index - static_cast<int>(std::distance(removed.begin(), it));
+    };
+    m_table.mapSpanElements(orientation, map);
+    emitCountChanged(orientation);
+    if (shift > 0)
+        shiftContent(orientation, -shift);
+
+    remapElements(orientation, map);
+}
+
+void TableViewPrivate::moveElements(Qt::Orientation orientation, int first, int count, int to)
+{
+    const int length = axis(orientation).length();
+    if (count <= 0 || first < 0 || first + count > length || to < 0 || to > length)
+        return;
+    if (to >= first && to <= first + count)
+        return;
+
+    // Elements of a reordered axis, and their spans, stay where they are
+    // shown and only their model indexes change
+    if (!order(orientation).isIdentity()) {
+        order(orientation).moveLogical(first, count, to);
+        remapElements(orientation, [](int index) { return index; });
+        return;
+    }
+
+    // A move is a removal followed by an insertion with respect to the
+    // visible area
+    const std::int64_t visibleBegin = origin(orientation) + (orientation == Qt::Horizontal ? m_visibleArea.left() : m_visibleArea.top());
+    const std::pair<std::int64_t, std::int64_t> span = visualSpan(axis(orientation), first, count);
+    std::int64_t shift = -std::max<std::int64_t>(0, std::min(span.second, visibleBegin) - span.first);
+
+    const int newFirst = to > first ? to - count : to;
+    axis(orientation).move(first, count, to);
+    if (visualSpan(axis(orientation), newFirst, count).first < visibleBegin + shift)
+        shift += span.second - span.first;
+    if (shift != 0)
+        shiftContent(orientation, shift);
+
+    auto map = [first, count, to, newFirst](int index) {
+        if (index >= first && index < first + count)
+            return newFirst + index - first;
+        if (to > first && index >= first + count && index < to)
+            return index - count;
+        if (to < first && index >= to && index < first)
+            return index + count;
+        return index;
+    };
+    m_table.mapSpanElements(orientation, map);
+    remapElements(orientation, map);
+}
+
+std::int64_t TableViewPrivate::origin(Qt::Orientation orientation) const
+{
+    return orientation == Qt::Horizontal ? m_table.xOrigin() : m_table.yOrigin();
+}
+
+std::int64_t TableViewPrivate::maximumOrigin(Qt::Orientation orientation) const
+{
+    const TreeAxis &axis = orientation == Qt::Horizontal ? m_table.xAxis() : m_table.yAxis();
+    return std::max<std::int64_t>(0, axis.visualLength() - maximumContentLength);
+}
+
+void TableViewPrivate::setOrigin(Qt::Orientation orientation, std::int64_t origin)
+{
+    if (this->origin(orientation) == origin)
+        return;
+    if (orientation == Qt::Horizontal)
+        m_table.setOrigin(origin, m_table.yOrigin());
+    else
+        m_table.setOrigin(m_table.xOrigin(), origin);
+    emit originChanged(this->origin());
+}
+
+void TableViewPrivate::shiftContent(Qt::Orientation orientation, std::int64_t delta)
+{
+    // The origin absorbs as much of the shift as possible, while the
+    // flickable follows the rest so that the content does not jump
+    const std::int64_t oldOrigin = origin(orientation);
+    const std::int64_t newOrigin = std::clamp<std::int64_t>(oldOrigin + delta, 0, maximumOrigin(orientation));
+    setOrigin(orientation, newOrigin);
+
+    const int contentDelta = static_cast<int>(delta - (newOrigin - oldOrigin));
+    if (contentDelta == 0)
+        return;
+    const QPoint offset = orientation == Qt::Horizontal ? QPoint(contentDelta, 0) : QPoint(0, contentDelta);
+    m_visibleArea.translate(offset);
+    emit visibleAreaChanged(m_visibleArea);
+    emit contentShifted(offset);
+}
+
+bool TableViewPrivate::rebaseOrigin()
+{
+    // The origin is moved so that the visible area returns to the middle
+    // of the window once it reaches one of its outer quarters
+    auto rebase = [this](Qt::Orientation orientation, int begin, int length) {
+        const std::int64_t oldOrigin = origin(orientation);
+        const std::int64_t maxOrigin = maximumOrigin(orientation);
+        const bool nearBegin = begin < maximumContentLength / 4 && oldOrigin > 0;
+        const bool nearEnd = begin + length > maximumContentLength / 4 * 3 && oldOrigin < maxOrigin;
+        if (!nearBegin && !nearEnd && oldOrigin <= maxOrigin)
+            return 0;
+        const std::int64_t target = oldOrigin + begin + length / 2 - maximumContentLength / 2;
+        const std::int64_t newOrigin = std::clamp<std::int64_t>(target, 0, maxOrigin);
+        setOrigin(orientation, newOrigin);
+        return static_cast<int>(newOrigin - oldOrigin);
+    };
+    const QPoint delta(rebase(Qt::Horizontal, m_visibleArea.left(), m_visibleArea.width()),
+                       rebase(Qt::Vertical, m_visibleArea.top(), m_visibleArea.height()));
+    if (delta.isNull())
+        return false;
+
+    m_visibleArea.translate(-delta);
+    emit visibleAreaChanged(m_visibleArea);
+    emit contentShifted(-delta);
+    remapElements(Qt::Vertical, [](int index) { return index; });
+    return true;
+}
+
+void TableViewPrivate::remapElements(Qt::Orientation orientation, const std::function<int(int)> &map)
+{
+    // Pending data changes refer to the indexes before the change
+    applyDataChanges();
+    updateGeometry();
+
+    // Rows waiting for their measurement move along with their elements
+    if (orientation == Qt::Vertical) {
+        for (int &row : m_rowsToMeasure)
+            row = map(row);
+        stdutils::remove_if(m_rowsToMeasure, [](int row) { return row == -1; });
+    }
+
+    const QRect cacheArea = overscan::area(m_visibleArea, m_horizontalCacheBuffer, m_verticalCacheBuffer, m_velocity);
+    const QRect liveIndexes = m_table.indexesInVisualRect(cacheArea);
+    m_visibleIndexes = m_table.indexesInVisualRect(m_visibleArea);
+
+    // Live elements keep their item and move to their new cell, while the
+    // ones that are removed or not live anymore are recycled. The keys of
+    // the elements that move are all taken out before any is put back,
+    // since an element may move to the cell another one leaves
+    struct Target
+    {
+        std::optional<Cell> cell;
+        bool rekey = false;
+    };
+    std::vector<Target> targets(m_elements.size());
+    for (std::size_t i = 0; i < m_elements.size(); ++i) {
+        const Cell cell = m_elements[i]->cell();
+        const int row = orientation == Qt::Vertical ? map(cell.row()) : cell.row();
+        const int column = orientation == Qt::Horizontal ? map(cell.column()) : cell.column();
+        // Hidden cells have no extent and no element
+        const std::optional<Cell> mapped = row == -1 || column == -1 ? std::nullopt : m_table.cellAt(row, column);
+        if (mapped && !mapped->rect().isEmpty() && isLive(liveIndexes, row, column) && usesDelegate(column))
+            targets[i].cell = placeCell(*mapped);
+        targets[i].rekey = !targets[i].cell || row != cell.row() || column != cell.column();
+        if (targets[i].rekey)
+            m_elementIndexes.remove(cell.row(), cell.column());
+    }
+    for (std::size_t i = 0; i < m_elements.size(); ) {
+        if (!targets[i].cell) {
+            std::unique_ptr<TableViewPrivateElement> element = std::move(m_elements[i]);
+            if (i + 1 != m_elements.size()) {
+                m_elements[i] = std::move(m_elements.back());
+                targets[i] = std::move(targets.back());
+                // The element taking the slot is found by its new index
+                targets[i].rekey = true;
+            }
+            m_elements.pop_back();
+            targets.pop_back();
+            recycleElement(std::move(element));
+            continue;
+        }
+        // Elements keeping their cell may show another model index, and
+        // only the ones that do may switch delegates
+        const Cell &cell = *targets[i].cell;
+        if (m_elements[i]->setCell(cell) && m_elements[i]->delegate() != delegateFor(cell.row(), cell.column()))
+            scheduleIncubation(m_elements[i].get());
+        if (targets[i].rekey)
+            m_elementIndexes.insert(cell.row(), cell.column(), static_cast<int>(i));
+        ++i;
+    }
+
+    // The surviving elements may not cover the live area anymore
+    m_liveIndexes = QRect();
+    acquireLiveElements(liveIndexes);
+    m_liveIndexes = liveIndexes;
+
+    updatePool();
+    if (m_lightweightCells)
+        invalidatePaint();
+}
+
+// Return the row of the tree showing the row of index, or -1 if there is none
+int TableViewPrivate::treeRow(const QModelIndex &index) const
+{
+    std::vector<int> path;
+    for (QModelIndex i = index; i.isValid(); i = i.parent())
+        path.push_back(i.row());
+    if (path.empty())
+        return -1;
+    std::reverse(path.begin(), path.end());
+    return m_treeRows.find(path);
+}
+
+// Return the subtrees of the rows first to last of parent in depth first
+// order, with depths relative to parent. The rows left to walk at each
+// level are kept on a stack, so that deep trees do not recurse
+std::vector<TreeRows::Node> TableViewPrivate::treeNodes(const QModelIndex &parent, int first, int last) const
+{
+    struct Level
+    {
+        QModelIndex parent;
+        int next;
+        int last;
+    };
+    std::vector<TreeRows::Node> nodes;
+    std::vector<Level> stack{{parent, first, last}};
+    while (!stack.empty()) {
+        Level &level = stack.back();
+        if (level.next > level.last) {
+            stack.pop_back();
+            continue;
+        }
+        TreeRows::Node node;
+        node.modelRow = level.next++;
+        node.depth = static_cast<int>(stack.size()) - 1;
+        nodes.push_back(node);
+        const QModelIndex index = m_model->index(node.modelRow, 0, level.parent);
+        const int rowCount = m_model->rowCount(index);
+        if (rowCount > 0)
+            stack.push_back({index, 0, rowCount - 1});
+    }
+    return nodes;
+}
+
+// Return the ranges of rows of nodes, which are collapsed, below hideCount
+// collapsed rows
+std::vector<Range> TableViewPrivate::treeRanges(const std::vector<TreeRows::Node> &nodes, int hideCount) const
+{
+    std::vector<Range> ranges;
+    for (const TreeRows::Node &node : nodes) {
+        if (!ranges.empty() && ranges.back().hideCount() == hideCount + node.depth)
+            ranges.back() = ranges.back().resized(ranges.back().length() + 1);
+        else
+            ranges.emplace_back(1, m_defaultRowHeight, hideCount + node.depth);
+    }
+    return ranges;
+}
+
+void TableViewPrivate::resetTreeRows()
+{
+    const int rowCount = m_model->rowCount();
+    std::vector<TreeRows::Node> nodes;
+    if (rowCount > 0)
+        nodes = treeNodes(QModelIndex(), 0, rowCount - 1);
+    const std::vector<Range> ranges = treeRanges(nodes, 0);
+    m_treeRows.clear();
+    m_treeRows.insert(-1, 0, std::move(nodes));
+
+    TreeAxis &axis = m_table.yAxis();
+    axis.removeAt(0, axis.length());
+    for (const Range &range : ranges)
+        axis.insertAt(axis.length(), range);
+    m_rowOrder.reset(axis.length());
+
+    // Showing the descendants of every row expanded before the change
+    // leaves the ones below its collapsed descendants hidden
+    for (const QPersistentModelIndex &index : m_expandedIndexes) {
+        const int row = treeRow(index);
+        if (row == -1 || m_treeRows.node(row).expanded)
+            continue;
+        m_treeRows.setExpanded(row, true);
+        if (m_treeRows.node(row).descendants > 0)
+            axis.show(row + 1, m_treeRows.node(row).descendants);
+    }
+    m_expandedIndexes.clear();
+    emitCountChanged(Qt::Vertical);
+}
+
+void TableViewPrivate::saveExpandedRows()
+{
+    m_expandedIndexes.clear();
+    if (!m_tree)
+        return;
+    for (int row = 0; row < m_treeRows.size(); ++row)
+        if (m_treeRows.node(row).expanded)
+            m_expandedIndexes.emplace_back(modelIndex(row, 0));
+}
+
+void TableViewPrivate::insertTreeRows(const QModelIndex &parent, int first, int last)
+{
+    const int parentRow = parent.isValid() ? treeRow(parent) : -1;
+    if (parent.isValid() && parentRow == -1)
+        return;
+
+    // The new rows are collapsed and below the collapsed ancestors of parent
+    std::vector<TreeRows::Node> nodes = treeNodes(parent, first, last);
+    const std::vector<Range> ranges = treeRanges(nodes, m_treeRows.collapsedCount(parentRow));
+    const int row = m_treeRows.insert(parentRow, first, std::move(nodes));
+    insertElements(Qt::Vertical, row, ranges);
+    if (parentRow != -1)
+        updateTreeState(parentRow);
+}
+
+void TableViewPrivate::removeTreeRows(const QModelIndex &parent, int first, int last)
+{
+    const int parentRow = parent.isValid() ? treeRow(parent) : -1;
+    if (parent.isValid() && parentRow == -1)
+        return;
+
+    // The removed rows and their descendants are a single run
+    const int firstRow = m_treeRows.childRow(parentRow, first);
+    const int lastRow = m_treeRows.childRow(parentRow, last);
+    if (firstRow == -1 || lastRow == -1)
+        return;
+    const int count = m_treeRows.subtreeEnd(lastRow) - firstRow;
+    m_treeRows.remove(firstRow, count);
+    removeElements(Qt::Vertical, firstRow, count);
+    if (parentRow != -1)
+        updateTreeState(parentRow);
+}
+
+// Expanding or collapsing a row shows or hides its descendants in a single
+// operation of the row axis. Elements above the row keep their cell
+bool TableViewPrivate::setExpanded(int row, bool expanded)
+{
+    if (!m_tree || row < 0 || row >= m_treeRows.size() || m_treeRows.node(row).expanded == expanded)
+        return false;
+    const int descendants = m_treeRows.node(row).descendants;
+    m_treeRows.setExpanded(row, expanded);
+    if (descendants > 0 && !setHidden(Qt::Vertical, row + 1, descendants, !expanded)) {
+        m_treeRows.setExpanded(row, !expanded);
+        return false;
+    }
+    updateTreeState(row);
+    return true;
+}
+
+void TableViewPrivate::updateTreeState(int row)
+{
+    for (const Cell &cell : elementCells(QRect(0, row, columnCount(), 1)))
+        elementAt(cell.row(), cell.column())->updateTreeState();
+}
+
+void TableViewPrivate::onVisibleAreaChanged()
+{
+    // A drag would put back the content shifted under it, while a flick
+    // is started again by the flickable after the shift
+    if (!m_dragging && rebaseOrigin())
+        return;
+
+    // Live elements cover the visible area grown by the cache buffers
+    // toward the direction of travel
+    const QRect cacheArea = overscan::area(m_visibleArea, m_horizontalCacheBuffer, m_verticalCacheBuffer, m_velocity);
+    const QRect liveIndexes = m_table.indexesInVisualRect(cacheArea);
+    const QRect visibleIndexes = m_table.indexesInVisualRect(m_visibleArea);
+    // Frozen lightweight cells move with every change of the visible area
+    if (m_lightweightCells && (visibleIndexes != m_visibleIndexes || m_frozenRows > 0 || m_frozenColumns > 0))
+        invalidatePaint();
+    m_visibleIndexes = visibleIndexes;
+    if (liveIndexes == m_liveIndexes) {
+        layoutFrozenElements();
+        return;
+    }
+
+    // Remove elements of the strips of cells that are not live anymore.
+    // Frozen cells are shared by the strips of the body and of the headers
+    const std::array<QRect, 4> oldRects = liveRects(m_liveIndexes);
+    const std::array<QRect, 4> newRects = liveRects(liveIndexes);
+    for (std::size_t i = 0; i < oldRects.size(); ++i) {
+        forEachStrip(oldRects[i], newRects[i], [this, liveIndexes](QRect strip) {
+            for (const Cell &cell : elementCells(strip))
+                if (!isLive(liveIndexes, cell.row(), cell.column()))
+                    releaseElement(cell.row(), cell.column());
+            // Spans out of the strips keep a cell in the new rect. Releasing
+            // a span crossing several strips again does nothing
+            m_table.spans().forEachIntersecting(strip, [this, liveIndexes](QRect span) {
+                if (!isLive(liveIndexes, span.top(), span.left()))
+                    releaseElement(span.top(), span.left());
+            });
+        });
+    }
+
+    // Add new elements only for the strips of cells that become live
+    acquireLiveElements(liveIndexes);
+
+    m_liveIndexes = liveIndexes;
+    layoutFrozenElements();
+
+    updatePool();
+}
+
+void TableViewPrivate::onDelegateDestroyed(QObject *delegate)
+{
+    // Only the address of the delegate is left, which another delegate
+    // may take afterwards
+    dropStalePendingIncubations();
+    m_pools.erase(static_cast<QQmlComponent*>(delegate));
+}
+
+void TableViewPrivate::onDelegatesChanged()
+{
+    // Pooled items of the delegates that are not used anymore are destroyed
+    QList<QQmlComponent*> delegates = m_delegateChooser ? m_delegateChooser->delegates() : QList<QQmlComponent*>();
+    delegates.append(m_cellDelegate);
+    dropStalePendingIncubations();
+    for (auto it = m_pools.begin(); it != m_pools.end(); ) {
+        if (it->first && !delegates.contains(it->first))
+            it = m_pools.erase(it);
+        else
+            ++it;
+    }
+
+    // Live items keep showing until they are replaced within the incubation budget
+    for (const auto &element : m_elements) {
+        const Cell cell = element->cell();
+        QQmlComponent *delegate = delegateFor(cell.row(), cell.column());
+        if (!delegate) {
+            if (m_incubatingElement == element.get())
+                m_incubatingElement = nullptr;
+            element->clearItem();
+        } else if (element->delegate() != delegate)
+            scheduleIncubation(element.get());
+    }
+}
+
+// The lightweight cells are drawn from the last polish, which may be the
+// only chance of their data to change
+void TableViewPrivate::invalidatePaint()
+{
+    m_paintDirty = true;
+    if (!m_polishing)
+        polish();
+}
+
+// Read the lightweight cells to draw on the gui thread, since the model
+// cannot be used from the render thread
+void TableViewPrivate::updatePaintCells()
+{
+    m_paintCells.clear();
+    m_paintFrozenBegin = 0;
+    if (!m_lightweightCells)
+        return;
+
+    // Frozen cells follow the body so that their nodes stack over it.
+    // Spans replace the cells they merge in the body
+    const std::array<QRect, 4> visibleRects = liveRects(m_visibleIndexes);
+    std::vector<Cell> cells;
+    m_table.cellsInIndexRect(visibleRects[0], cells);
+    std::vector<Cell> extraCells;
+    if (!m_table.spans().empty()) {
+        stdutils::remove_if(cells, [this](const Cell &cell) { return m_table.spanAt(cell.row(), cell.column()).has_value(); });
+        m_table.spansInIndexRect(visibleRects[0], extraCells);
+        cells.insert(cells.end(), extraCells.begin(), extraCells.end());
+    }
+    stdutils::remove_if(cells, [this](const Cell &cell) { return usesDelegate(cell.column()); });
+    if (m_stretchLastColumn) {
+        for (Cell &cell : cells)
+            cell = placeCell(cell);
+    }
+    const std::size_t frozenBegin = cells.size();
+    for (std::size_t i = 1; i < visibleRects.size(); ++i) {
+        m_table.cellsInIndexRect(visibleRects[i], extraCells);
+        for (const Cell &cell : extraCells)
+            if (!usesDelegate(cell.column()) && !isMerged(cell.row(), cell.column()))
+                cells.push_back(placeCell(cell));
+    }
+
+    for (const Cell &cell : cells) {
+        PaintCell paintCell;
+        paintCell.rect = cell.rect();
+        paintCell.background = colorData(cellData(cell.row(), cell.column(), Qt::BackgroundRole), Qt::white);
+        paintCell.foreground = colorData(cellData(cell.row(), cell.column(), Qt::ForegroundRole), Qt::black);
+        paintCell.text = cellData(cell.row(), cell.column(), Qt::DisplayRole).toString();
+        m_paintCells.push_back(std::move(paintCell));
+    }
+    m_paintFrozenBegin = frozenBegin;
+}
+
+QSGNode *TableViewPrivate::updatePaintNode(QSGNode *oldNode, QQuickItem::UpdatePaintNodeData *)
+{
+    if (!m_lightweightCells) {
+        delete oldNode;
+        return nullptr;
+    }
+
+    // Nodes of the previous frame are reused in order, and so are the
+    // textures of the texts that are still drawn
+    auto node = oldNode ? static_cast<LightweightCellsNode*>(oldNode) : new LightweightCellsNode();
+    const std::array<std::size_t, 3> bounds = {0, m_paintFrozenBegin, m_paintCells.size()};
+    for (std::size_t i = 0; i < node->layers.size(); ++i) {
+        const LightweightCellsNode::Layer &layer = node->layers[i];
+        QSGNode *rectangleChild = layer.rectangles->firstChild();
+        QSGNode *textChild = layer.texts->firstChild();
+        for (std::size_t j = bounds[i]; j < bounds[i + 1]; ++j) {
+            const PaintCell &cell = m_paintCells[j];
+            QSGRectangleNode *rectangle = nextChild<QSGRectangleNode>(layer.rectangles, rectangleChild, [this] {
+                return window()->createRectangleNode();
+            });
+            rectangle->setRect(cell.rect);
+            rectangle->setColor(cell.background);
+            if (cell.text.isEmpty() || cell.rect.isEmpty())
+                continue;
+
+            QSGImageNode *text = nextChild<QSGImageNode>(layer.texts, textChild, [this] {
+                return window()->createImageNode();
+            });
+            QSGTexture *texture = node->texture(window(), cell.text, cell.foreground, cell.rect.size());
+            if (text->texture() != texture)
+                text->setTexture(texture);
+            text->setRect(cell.rect);
+        }
+        removeChildren(layer.rectangles, rectangleChild);
+        removeChildren(layer.texts, textChild);
+    }
+    node->releaseUnusedTextures();
+
+    return node;
+}
+
+void TableViewPrivate::updateGeometry()
+{
+    const std::int64_t width = std::min<std::int64_t>(m_table.xAxis().visualLength(), maximumContentLength);
+    const std::int64_t height = std::min<std::int64_t>(m_table.yAxis().visualLength(), maximumContentLength);
+    setSize(QSizeF(width, height));
+
+    const QSizeF tableSize(m_table.xAxis().visualLength(), m_table.yAxis().visualLength());
+    if (m_tableSize != tableSize) {
+        m_tableSize = tableSize;
+        emit tableSizeChanged(m_tableSize);
+    }
+}
+
+TableViewIncubator::TableViewIncubator(TableViewPrivateElement &element)
+    : QQmlIncubator(QQmlIncubator::Asynchronous)
+    , m_element(element)
+{}
+
+TableViewIncubationController::TableViewIncubationController(TableViewPrivate &view)
+    : m_view(view)
+{}
+
+void TableViewIncubationController::incubatingObjectCountChanged(int count)
+{
+    m_view.onIncubatingObjectCountChanged(count);
+}
 
 void TableViewIncubator::statusChanged(QQmlIncubator::Status status)
 {
@@ -18,20 +18,74 @@
 #pragma once
 
 #include "cell.h"
+#include "cellhash.h"
+#include "delegatechooser.h"
+#include "permutation.h"
 #include "table.h"
+#include "treerows.h"
 
+#include <array>
+#include <functional>
 #include <memory>
 #include <stack>
+#include <unordered_map>
 
+#include <QAbstractItemModel>
+#include <QColor>
+#include <QElapsedTimer>
 #include <QQmlComponent>
 #include <QQmlIncubator>
 #include <QQmlContext>
+#include <QQmlPropertyMap>
 #include <QPointer>
 #include <QQuickItem>
+#include <QTimer>
 
 class TableViewPrivate;
 class TableViewPrivateElement;
 
+// Context object of the delegates. It outlives the recycling of its element
+// so that a reuse only writes the properties whose value changed
+class TableViewPrivateCellContext : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int row READ row NOTIFY rowChanged)
+    Q_PROPERTY(int column READ column NOTIFY columnChanged)
+    // The row under the name of the delegates of a list
+    Q_PROPERTY(int index READ row NOTIFY rowChanged)
+    Q_PROPERTY(int depth READ depth NOTIFY depthChanged)
+    Q_PROPERTY(bool hasChildren READ hasChildren NOTIFY hasChildrenChanged)
+    Q_PROPERTY(bool expanded READ expanded NOTIFY expandedChanged)
+    Q_PROPERTY(QQmlPropertyMap* model READ model CONSTANT)
+
+public:
+    int row() const { return m_row; }
+    int column() const { return m_column; }
+    int depth() const { return m_depth; }
+    bool hasChildren() const { return m_hasChildren; }
+    bool expanded() const { return m_expanded; }
+    QQmlPropertyMap *model() { return &m_model; }
+
+    void setCell(int row, int column);
+    void setTreeState(int depth, bool hasChildren, bool expanded);
+    void setRole(const QString &name, const QVariant &value);
+
+signals:
+    void rowChanged(int row);
+    void columnChanged(int column);
+    void depthChanged(int depth);
+    void hasChildrenChanged(bool hasChildren);
+    void expandedChanged(bool expanded);
+
+private:
+    int m_row = 0;
+    int m_column = 0;
+    int m_depth = 0;
+    bool m_hasChildren = false;
+    bool m_expanded = false;
+    QQmlPropertyMap m_model;
+};
+
 class TableViewIncubator : public QQmlIncubator
 {
 public:
@@ -45,6 +99,20 @@ private:
     TableViewPrivateElement &m_element;
 };
 
+// The controller of a view, installed on the engine only when the engine
+// has none. It asks the view for frames while objects are incubating
+class TableViewIncubationController : public QQmlIncubationController
+{
+public:
+    TableViewIncubationController(TableViewPrivate &view);
+
+protected:
+    void incubatingObjectCountChanged(int count) final;
+
+private:
+    TableViewPrivate &m_view;
+};
+
 class TableViewPrivateElement
 {
 public:
@@ -52,24 +120,46 @@ public:
     ~TableViewPrivateElement();
 
     Cell cell() const { return m_cell; }
-    void setCell(Cell c);
+    // Returns whether the element may show another model index
+    bool setCell(Cell c);
+
+    QQuickItem *item() const { return m_item.get(); }
+    // Delegate of the item, or of the failed incubation that left none
+    QQmlComponent *delegate() const { return m_delegate; }
+    bool incubating() const { return m_incubator && m_incubator->isLoading(); }
+
+    bool scheduled() const { return m_scheduled; }
+    void setScheduled(bool scheduled) { m_scheduled = scheduled; }
 
     bool visible() const;
     void setVisible(bool visible);
 
-    void createItem();
+    // Start the incubation of an item of delegate. The current item, if
+    // any, keeps showing until the new one is ready
+    void createItem(QQmlComponent *delegate);
+    void cancelIncubation();
     void clearItem();
 
+    // Refresh the given roles of the cell context, or all of them if roles is empty
+    void updateData(const QVector<int> &roles);
+    void updateTreeState();
+
     void onIncubatorStatusChanged(QQmlIncubator::Status status);
     void onIncubatorSetInitialState(QObject *object);
 
 private:
+    void placeItem(QQuickItem *item) const;
+
     TableViewPrivate &m_table;
     Cell m_cell;
+    TableViewPrivateCellContext m_cellContext;
+    QPointer<QQmlComponent> m_delegate;
+    QPointer<QQmlComponent> m_incubatingDelegate;
     std::unique_ptr<QQmlContext> m_context;
     std::unique_ptr<QQmlIncubator> m_incubator;
     std::unique_ptr<QQuickItem> m_item;
     bool m_visible = true;
+    bool m_scheduled = false;
 };
 
 class TableViewPrivate : public QQuickItem
@@ -77,36 +167,301 @@ class TableViewPrivate : public QQuickItem
     Q_OBJECT
     Q_DISABLE_COPY(TableViewPrivate)
 
+    Q_PROPERTY(QAbstractItemModel* model READ model WRITE setModel NOTIFY modelChanged)
+    Q_PROPERTY(int rowCount READ rowCount WRITE setRowCount NOTIFY rowCountChanged)
+    Q_PROPERTY(int columnCount READ columnCount WRITE setColumnCount NOTIFY columnCountChanged)
+    Q_PROPERTY(int defaultRowHeight READ defaultRowHeight WRITE setDefaultRowHeight NOTIFY defaultRowHeightChanged)
+    Q_PROPERTY(int frozenRows READ frozenRows WRITE setFrozenRows NOTIFY frozenRowsChanged)
+    Q_PROPERTY(int frozenColumns READ frozenColumns WRITE setFrozenColumns NOTIFY frozenColumnsChanged)
+    Q_PROPERTY(bool tree READ tree WRITE setTree NOTIFY treeChanged)
+    Q_PROPERTY(bool autoRowHeight READ autoRowHeight WRITE setAutoRowHeight NOTIFY autoRowHeightChanged)
+    Q_PROPERTY(int defaultColumnWidth READ defaultColumnWidth WRITE setDefaultColumnWidth NOTIFY defaultColumnWidthChanged)
+    Q_PROPERTY(bool stretchLastColumn READ stretchLastColumn WRITE setStretchLastColumn NOTIFY stretchLastColumnChanged)
     Q_PROPERTY(QQmlComponent* cellDelegate READ cellDelegate WRITE setCellDelegate NOTIFY cellDelegateChanged)
+    Q_PROPERTY(DelegateChooser* delegateChooser READ delegateChooser WRITE setDelegateChooser NOTIFY delegateChooserChanged)
     Q_PROPERTY(QRect visibleArea READ visibleArea WRITE setVisibleArea NOTIFY visibleAreaChanged)
+    Q_PROPERTY(QPointF velocity READ velocity WRITE setVelocity NOTIFY velocityChanged)
+    Q_PROPERTY(bool moving READ moving WRITE setMoving NOTIFY movingChanged)
+    Q_PROPERTY(bool dragging READ dragging WRITE setDragging NOTIFY draggingChanged)
+    // Position of the content window in the table, and size of the table,
+    // for the positions shown to the user such as those of scroll bars
+    Q_PROPERTY(QPointF origin READ origin NOTIFY originChanged)
+    Q_PROPERTY(QSizeF tableSize READ tableSize NOTIFY tableSizeChanged)
+    Q_PROPERTY(int horizontalCacheBuffer READ horizontalCacheBuffer WRITE setHorizontalCacheBuffer NOTIFY horizontalCacheBufferChanged)
+    Q_PROPERTY(int verticalCacheBuffer READ verticalCacheBuffer WRITE setVerticalCacheBuffer NOTIFY verticalCacheBufferChanged)
+    Q_PROPERTY(int incubationBudget READ incubationBudget WRITE setIncubationBudget NOTIFY incubationBudgetChanged)
+    Q_PROPERTY(int poolSize READ poolSize WRITE setPoolSize NOTIFY poolSizeChanged)
+    Q_PROPERTY(int poolIdleTimeout READ poolIdleTimeout WRITE setPoolIdleTimeout NOTIFY poolIdleTimeoutChanged)
+    Q_PROPERTY(int poolHighWaterMark READ poolHighWaterMark NOTIFY poolHighWaterMarkChanged)
+    Q_PROPERTY(bool lightweightCells READ lightweightCells WRITE setLightweightCells NOTIFY lightweightCellsChanged)
+    Q_PROPERTY(QList<int> delegateColumns READ delegateColumns WRITE setDelegateColumns NOTIFY delegateColumnsChanged)
 
 public:
     TableViewPrivate(QQuickItem *parent = nullptr);
     ~TableViewPrivate();
 
+    QAbstractItemModel* model() const;
+    int rowCount() const;
+    int columnCount() const;
+    int defaultRowHeight() const;
+    bool autoRowHeight() const;
+    bool tree() const;
+    int frozenRows() const;
+    int frozenColumns() const;
+    int defaultColumnWidth() const;
+    bool stretchLastColumn() const;
     QQmlComponent* cellDelegate() const;
+    DelegateChooser* delegateChooser() const;
     QRect visibleArea() const;
+    QPointF velocity() const;
+    bool moving() const;
+    bool dragging() const;
+    QPointF origin() const;
+    QSizeF tableSize() const;
+    int horizontalCacheBuffer() const;
+    int verticalCacheBuffer() const;
+    int incubationBudget() const;
+    int poolSize() const;
+    int poolIdleTimeout() const;
+    int poolHighWaterMark() const;
+    bool lightweightCells() const;
+    QList<int> delegateColumns() const;
+
+    Q_INVOKABLE QQuickItem *itemAt(int row, int column) const;
+    Q_INVOKABLE void trimCache();
+    Q_INVOKABLE bool setSpan(int row, int column, int rowSpan, int columnSpan);
+    Q_INVOKABLE void clearSpans();
+    Q_INVOKABLE bool setRowOrder(const QList<int> &order);
+    Q_INVOKABLE bool setColumnOrder(const QList<int> &order);
+    Q_INVOKABLE bool hideRows(int row, int count);
+    Q_INVOKABLE bool showRows(int row, int count);
+    Q_INVOKABLE bool hideColumns(int column, int count);
+    Q_INVOKABLE bool showColumns(int column, int count);
+    Q_INVOKABLE bool expand(int row);
+    Q_INVOKABLE bool collapse(int row);
+    Q_INVOKABLE bool isExpanded(int row) const;
+    Q_INVOKABLE void scrollTo(QPointF position);
+
+    const QHash<int, QByteArray> &roleNames() const;
+    QVariant cellData(int row, int column, int role) const;
+    int modelRow(int row) const;
+    int modelColumn(int column) const;
+    int rowDepth(int row) const;
+    bool rowHasChildren(int row) const;
+    void scheduleRowMeasurement(int row);
+    void onIncubationFinished(TableViewPrivateElement *element, bool ready);
+    void onIncubatingObjectCountChanged(int count);
+    int cellZ(int row, int column) const;
 
 public slots:
+    void setModel(QAbstractItemModel *model);
+    void setRowCount(int rowCount);
+    void setColumnCount(int columnCount);
+    void setDefaultRowHeight(int defaultRowHeight);
+    void setAutoRowHeight(bool autoRowHeight);
+    void setTree(bool tree);
+    void setFrozenRows(int frozenRows);
+    void setFrozenColumns(int frozenColumns);
+    void setDefaultColumnWidth(int defaultColumnWidth);
+    void setStretchLastColumn(bool stretchLastColumn);
     void setCellDelegate(QQmlComponent *cellDelegate);
+    void setDelegateChooser(DelegateChooser *delegateChooser);
     void setVisibleArea(QRect visibleArea);
+    void setVelocity(QPointF velocity);
+    void setMoving(bool moving);
+    void setDragging(bool dragging);
+    void setHorizontalCacheBuffer(int horizontalCacheBuffer);
+    void setVerticalCacheBuffer(int verticalCacheBuffer);
+    void setIncubationBudget(int incubationBudget);
+    void setPoolSize(int poolSize);
+    void setPoolIdleTimeout(int poolIdleTimeout);
+    void setLightweightCells(bool lightweightCells);
+    void setDelegateColumns(QList<int> delegateColumns);
 
 signals:
+    void modelChanged(QAbstractItemModel *model);
+    void rowCountChanged(int rowCount);
+    void columnCountChanged(int columnCount);
+    void defaultRowHeightChanged(int defaultRowHeight);
+    void autoRowHeightChanged(bool autoRowHeight);
+    void treeChanged(bool tree);
+    void frozenRowsChanged(int frozenRows);
+    void frozenColumnsChanged(int frozenColumns);
+    void defaultColumnWidthChanged(int defaultColumnWidth);
+    void stretchLastColumnChanged(bool stretchLastColumn);
     void cellDelegateChanged(QQmlComponent *cellDelegate);
+    void delegateChooserChanged(DelegateChooser *delegateChooser);
     void visibleAreaChanged(QRect visibleArea);
+    void velocityChanged(QPointF velocity);
+    void movingChanged(bool moving);
+    void draggingChanged(bool dragging);
+    void originChanged(QPointF origin);
+    void tableSizeChanged(QSizeF tableSize);
+    void horizontalCacheBufferChanged(int horizontalCacheBuffer);
+    void verticalCacheBufferChanged(int verticalCacheBuffer);
+    void incubationBudgetChanged(int incubationBudget);
+    void poolSizeChanged(int poolSize);
+    void poolIdleTimeoutChanged(int poolIdleTimeout);
+    void poolHighWaterMarkChanged(int poolHighWaterMark);
+    void lightweightCellsChanged(bool lightweightCells);
+    void delegateColumnsChanged(QList<int> delegateColumns);
+    void contentShifted(QPoint delta);
+
+protected:
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+    void updatePolish() override;
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
 
 private:
+    QQmlComponent *delegateFor(int row, int column) const;
     std::unique_ptr<TableViewPrivateElement> getOrCreateElement(Cell c);
+    TableViewPrivateElement *elementAt(int row, int column) const;
+    std::vector<Cell> elementCells(QRect indexes) const;
+    void acquireElement(Cell cell);
+    void acquireElements(QRect indexes);
+    void acquireLiveElements(QRect liveIndexes);
+    void acquireSpanElements(QRect indexes);
+    bool isMerged(int row, int column) const;
+    std::array<QRect, 4> liveRects(QRect indexes) const;
+    bool isLive(QRect liveIndexes, int row, int column) const;
+    Cell placeCell(Cell cell) const;
+    void layoutFrozenElements();
+    void layoutStretchedElements();
+    void releaseElement(int row, int column);
+    void recycleElement(std::unique_ptr<TableViewPrivateElement> element);
+    std::size_t pooledCount() const;
+    void schedulePolish();
+    void scheduleFrame();
+    void onAfterAnimating();
+    void scheduleIncubation(TableViewPrivateElement *element);
+    void startIncubation();
+    void incubatePendingElements(const QElapsedTimer &timer);
+    void releaseIncubationController();
+    void dropStalePendingIncubations();
+    void trimPool(std::size_t size);
+    void updatePool();
+    void resetElements();
+    void invalidatePaint();
+    void updatePaintCells();
+    bool usesDelegate(int column) const;
+    QModelIndex modelIndex(int row, int column) const;
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void applyDataChanges();
+    void applyRowMeasurements(const QElapsedTimer &timer);
+
+    TreeAxis &axis(Qt::Orientation orientation);
+    Permutation &order(Qt::Orientation orientation);
+    bool setOrder(Qt::Orientation orientation, const QList<int> &modelIndexes);
+    bool setHidden(Qt::Orientation orientation, int first, int count, bool hidden);
+    int defaultVisualLength(Qt::Orientation orientation) const;
+    void emitCountChanged(Qt::Orientation orientation);
+    void resetAxis(Qt::Orientation orientation);
+    void resetAxes();
+    void clampOrigin(Qt::Orientation orientation);
+    void saveLayout();
+    void restoreLayout();
+    void insertElements(Qt::Orientation orientation, int model, int count);
+    void insertElements(Qt::Orientation orientation, int model, const std::vector<Range> &ranges);
+    void removeElements(Qt::Orientation orientation, int model, int count);
+    void moveElements(Qt::Orientation orientation, int first, int count, int to);
+    std::int64_t origin(Qt::Orientation orientation) const;
+    std::int64_t maximumOrigin(Qt::Orientation orientation) const;
+    void setOrigin(Qt::Orientation orientation, std::int64_t origin);
+    void shiftContent(Qt::Orientation orientation, std::int64_t delta);
+    bool rebaseOrigin();
+    void remapElements(Qt::Orientation orientation, const std::function<int(int)> &map);
+
+    int treeRow(const QModelIndex &index) const;
+    std::vector<TreeRows::Node> treeNodes(const QModelIndex &parent, int first, int last) const;
+    std::vector<Range> treeRanges(const std::vector<TreeRows::Node> &nodes, int hideCount) const;
+    void resetTreeRows();
+    void saveExpandedRows();
+    void insertTreeRows(const QModelIndex &parent, int first, int last);
+    void removeTreeRows(const QModelIndex &parent, int first, int last);
+    bool setExpanded(int row, bool expanded);
+    void updateTreeState(int row);
 
     void onVisibleAreaChanged();
-    void onCellDelegateChanged();
+    void onDelegatesChanged();
+    void onDelegateDestroyed(QObject *delegate);
 
     void updateGeometry();
 
     Table m_table;
+    // Model index of the row and the column at every position of the axes
+    Permutation m_rowOrder;
+    Permutation m_columnOrder;
+    // Rows of the model in depth first order when the view is a tree
+    bool m_tree = false;
+    TreeRows m_treeRows;
+    std::vector<QPersistentModelIndex> m_expandedIndexes;
+    // Rows and columns of a flat model kept across a layout change
+    struct SavedElement
+    {
+        Qt::Orientation orientation;
+        QPersistentModelIndex index;
+        // -1 for the elements following the default visual length
+        int visualLength;
+        int hideCount;
+    };
+    std::vector<SavedElement> m_savedLayout;
     QRect m_visibleArea;
+    QPointF m_velocity;
+    bool m_moving = false;
+    bool m_dragging = false;
+    QSizeF m_tableSize;
+    int m_horizontalCacheBuffer = 0;
+    int m_verticalCacheBuffer = 0;
+    int m_incubationBudget = 5;
+    int m_poolSize = -1;
+    int m_poolHighWaterMark = 0;
+    QTimer m_poolIdleTimer;
+    QRect m_visibleIndexes;
+    QRect m_liveIndexes;
+    std::vector<Cell> m_cells;
+    // Lightweight cells drawn by updatePaintNode, of which the ones from
+    // m_paintFrozenBegin are frozen
+    struct PaintCell
+    {
+        QRect rect;
+        QColor background;
+        QColor foreground;
+        QString text;
+    };
+    std::vector<PaintCell> m_paintCells;
+    std::size_t m_paintFrozenBegin = 0;
+    bool m_paintDirty = false;
+    bool m_lightweightCells = false;
+    QList<int> m_delegateColumns;
+    QPointer<QAbstractItemModel> m_model;
+    int m_rowCount = 0;
+    int m_columnCount = 0;
+    int m_defaultRowHeight = 100;
+    int m_defaultColumnWidth = 100;
+    bool m_stretchLastColumn = false;
+    bool m_autoRowHeight = false;
+    int m_frozenRows = 0;
+    int m_frozenColumns = 0;
+    std::vector<int> m_rowsToMeasure;
+    QHash<int, QByteArray> m_roleNames;
+    QRect m_dirtyIndexes;
+    QVector<int> m_dirtyRoles;
+    bool m_dirtyAllRoles = false;
     QPointer<QQmlComponent> m_cellDelegate;
-    std::vector<std::unique_ptr<TableViewPrivateElement>> m_cache;
+    QPointer<DelegateChooser> m_delegateChooser;
+    // Recycled elements by the delegate of their item, oldest first. The
+    // pool of a delegate is dropped when the delegate is destroyed
+    std::unordered_map<QQmlComponent*, std::vector<std::unique_ptr<TableViewPrivateElement>>> m_pools;
     std::vector<std::unique_ptr<TableViewPrivateElement>> m_elements;
+    CellHash m_elementIndexes;
+    std::vector<TableViewPrivateElement*> m_pendingIncubations;
+    // The engine serves the incubation started last first, so that only
+    // one element incubates at a time for following the pending order
+    TableViewPrivateElement *m_incubatingElement = nullptr;
+    TableViewIncubationController m_incubationController{*this};
+    QMetaObject::Connection m_afterAnimatingConnection;
+    bool m_polishing = false;
+    bool m_polishDeferred = false;
+    bool m_frameScheduled = false;
 };
 
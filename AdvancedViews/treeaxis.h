@@ -0,0 +1,637 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "axis.h"
+#include "range.h"
+
+/*
+    TreeAxis exposes the same interface of Axis but stores the ranges
+    in the nodes of a treap ordered by position. Every node caches the number
+    of elements and the visual length of its subtree so that lookups,
+    insertions, removals and moves are logarithmic in the number of ranges.
+    Adjacent ranges with the same elements, as told by Range::hasSameElements(),
+    are always merged as done by Axis::fixRanges().
+
+    Hiding and showing a span adds to the hide count of the root of its
+    subtree and defers the addition to the children until they are
+    visited. Every node caches the smallest hide count of its subtree and
+    the visual length of the elements having it, which is the visual
+    length of the subtree when that count is zero.
+
+    While all the elements have the same visual length the tree is a single
+    node and lookups are answered arithmetically without visiting it.
+*/
+class TreeAxis
+{
+    friend class AdvancedViewsTest;
+
+public:
+    void append(int visualLength)
+    {
+        replace(length(), 0, Range(1, visualLength));
+    }
+
+    void append(const std::vector<int> &visualLengths)
+    {
+        // Collapse consecutive equal lengths so that each run costs one insertion
+        for (auto it = visualLengths.begin(); it != visualLengths.end(); ) {
+            const auto end = std::find_if(it, visualLengths.end(), [it](int l) { return l != *it; });
+            replace(length(), 0, Range(static_cast<int>(std::distance(it, end)), *it));
+            it = end;
+        }
+    }
+
+    bool move(int from, int to) {
+        return move(from, 1, to);
+    }
+
+    // Move count elements starting from from before the element at to.
+    // The destination is expressed in positions before the move
+    bool move(int from, int count, int to)
+    {
+        const int length = this->length();
+        if (from < 0 || count < 0 || to < 0 || from + count > length || to > length)
+            return false;
+        if (to >= from && to <= from + count) // Nothing to do
+            return true;
+
+        int left = -1, middle = -1, right = -1;
+        split(m_root, from, left, middle);
+        split(middle, count, middle, right);
+        const int rest = join(left, right);
+        split(rest, to > from ? to - count : to, left, right);
+        m_root = join(join(left, middle), right);
+        updateUniform();
+        return true;
+    }
+
+    // Reorder the elements so that the element at pos is the one at
+    // order[pos] before. The axis is rebuilt in one pass whatever the number
+    // of displaced elements
+    bool permute(const std::vector<int> &order)
+    {
+        const int length = this->length();
+        if (static_cast<int>(order.size()) != length)
+            return false;
+        std::vector<bool> seen(order.size(), false);
+        for (int pos : order) {
+            if (pos < 0 || pos >= length || seen[pos])
+                return false;
+            seen[pos] = true;
+        }
+        // Reordering equal elements changes nothing
+        if (m_uniformElementVisualLength != -1)
+            return true;
+
+        std::vector<Range> elements;
+        elements.reserve(order.size());
+        for (const Range &range : ranges())
+            elements.insert(elements.end(), range.length(), range.resized(1));
+        replace(0, length, Range(0, 0));
+        // Consecutive like elements cost one insertion
+        for (auto it = order.begin(); it != order.end(); ) {
+            const Range &element = elements[*it];
+            const auto end = std::find_if(it, order.end(), [&](int pos) { return !elements[pos].hasSameElements(element); });
+            replace(this->length(), 0, element.resized(static_cast<int>(std::distance(it, end))));
+            it = end;
+        }
+        return true;
+    }
+
+    bool insertAt(int pos, int visualLength)
+    {
+        return insertAt(pos, Range(1, visualLength));
+    }
+
+    // Insert range.length() elements of range.elementVisualLength() at pos
+    bool insertAt(int pos, Range range)
+    {
+        if (pos < 0 || pos > length() || range.length() < 0)
+            return false;
+        replace(pos, 0, range);
+        return true;
+    }
+
+    bool removeAt(int pos)
+    {
+        return removeAt(pos, 1);
+    }
+
+    // Remove count elements starting from pos
+    bool removeAt(int pos, int count)
+    {
+        if (pos < 0 || count < 0 || pos + count > length())
+            return false;
+        replace(pos, count, Range(0, 0));
+        return true;
+    }
+
+    // Set the visual length of the element at pos. Only the ranges
+    // adjacent to pos are split or merged
+    bool setVisualLength(int pos, int visualLength)
+    {
+        return setVisualLength(pos, 1, visualLength);
+    }
+
+    // Set the visual length of count elements starting from pos, which
+    // become fixed. Hidden elements stay hidden
+    bool setVisualLength(int pos, int count, int visualLength)
+    {
+        if (pos < 0 || count < 0 || pos + count > length())
+            return false;
+        int left = -1, middle = -1, right = -1;
+        split(m_root, pos, left, middle);
+        split(middle, count, middle, right);
+        std::vector<Range> ranges;
+        collectRanges(middle, 0, ranges);
+        destroyTree(middle);
+        for (const Range &range : ranges)
+            left = join(left, createNode(Range(range.length(), visualLength, range.hideCount(), true)));
+        m_root = join(left, right);
+        updateUniform();
+        return true;
+    }
+
+    // Set the visual length of every element that is not fixed. The axis
+    // is rebuilt in one pass over its ranges
+    void setDefaultVisualLength(int visualLength)
+    {
+        const std::vector<Range> ranges = this->ranges();
+        replace(0, length(), Range(0, 0));
+        for (const Range &range : ranges) {
+            replace(length(), 0, range.fixed() ? range
+                                               : Range(range.length(), visualLength, range.hideCount()));
+        }
+    }
+
+    // Hide count elements starting from pos. Hidden elements keep their
+    // position but take no visual space. Hides nest, so an element is
+    // shown again only once every hide is undone by a show
+    bool hide(int pos, int count)
+    {
+        return addHideCount(pos, count, 1);
+    }
+
+    // Undo a hide of count elements starting from pos. Nothing is done
+    // if any of them is not hidden
+    bool show(int pos, int count)
+    {
+        return addHideCount(pos, count, -1);
+    }
+
+    bool isHidden(int pos) const
+    {
+        int node = m_root;
+        int hideCount = 0;
+        while (node != -1) {
+            const Node &n = m_nodes[node];
+            const int leftLength = subtreeLength(n.left);
+            if (pos < leftLength) {
+                hideCount += n.pendingHideCount;
+                node = n.left;
+            } else if (pos < leftLength + n.range.length()) {
+                return n.range.hideCount() + hideCount > 0;
+            } else {
+                pos -= leftLength + n.range.length();
+                hideCount += n.pendingHideCount;
+                node = n.right;
+            }
+        }
+        return false;
+    }
+
+    bool visualRemoveAt(std::int64_t visualPos)
+    {
+        std::optional<AxisGetResult> result = visualGet(visualPos);
+        return result ? removeAt(result->pos) : false;
+    }
+
+    int length() const
+    {
+        return subtreeLength(m_root);
+    }
+
+    std::int64_t visualLength() const
+    {
+        return subtreeVisualLength(m_root);
+    }
+
+    std::optional<AxisGetResult> get(int pos) const
+    {
+        if (pos < 0 || pos >= length())
+            return std::optional<AxisGetResult>();
+        if (m_uniformElementVisualLength != -1)
+            return AxisGetResult(pos, static_cast<std::int64_t>(pos) * m_uniformElementVisualLength, m_uniformElementVisualLength);
+        // Hide counts deferred by the ancestors are added while descending
+        int node = m_root;
+        int hideCount = 0;
+        int minPos = 0;
+        std::int64_t minVisualPos = 0;
+        while (node != -1) {
+            const Node &n = m_nodes[node];
+            const int leftLength = subtreeLength(n.left);
+            if (pos < minPos + leftLength) {
+                hideCount += n.pendingHideCount;
+                node = n.left;
+                continue;
+            }
+            minPos += leftLength;
+            minVisualPos += subtreeVisualLength(n.left, hideCount + n.pendingHideCount);
+            const int elementVisualLength = visibleElementVisualLength(n.range, hideCount);
+            if (pos < minPos + n.range.length()) {
+                AxisGetResult result;
+                result.pos = pos;
+                result.visualPos = minVisualPos + static_cast<std::int64_t>(pos - minPos) * elementVisualLength;
+                result.visualLength = elementVisualLength;
+                return result;
+            }
+            minPos += n.range.length();
+            minVisualPos += static_cast<std::int64_t>(n.range.length()) * elementVisualLength;
+            hideCount += n.pendingHideCount;
+            node = n.right;
+        }
+        return std::optional<AxisGetResult>();
+    }
+
+    std::optional<AxisGetResult> visualGet(std::int64_t visualPos) const
+    {
+        if (visualPos < 0 || visualPos >= visualLength())
+            return std::optional<AxisGetResult>();
+        if (m_uniformElementVisualLength != -1) {
+            const int pos = static_cast<int>(visualPos / m_uniformElementVisualLength);
+            return AxisGetResult(pos, static_cast<std::int64_t>(pos) * m_uniformElementVisualLength, m_uniformElementVisualLength);
+        }
+        // Hidden ranges have no extent and are never landed on
+        int node = m_root;
+        int hideCount = 0;
+        int pos = 0;
+        std::int64_t minVisualPos = 0;
+        while (node != -1) {
+            const Node &n = m_nodes[node];
+            const std::int64_t leftVisualLength = subtreeVisualLength(n.left, hideCount + n.pendingHideCount);
+            if (visualPos < minVisualPos + leftVisualLength) {
+                hideCount += n.pendingHideCount;
+                node = n.left;
+                continue;
+            }
+            minVisualPos += leftVisualLength;
+            pos += subtreeLength(n.left);
+            const int elementVisualLength = visibleElementVisualLength(n.range, hideCount);
+            const std::int64_t rangeVisualLength = static_cast<std::int64_t>(n.range.length()) * elementVisualLength;
+            if (visualPos < minVisualPos + rangeVisualLength) {
+                const int offset = static_cast<int>((visualPos - minVisualPos) / elementVisualLength);
+                AxisGetResult result;
+                result.pos = pos + offset;
+                result.visualPos = minVisualPos + static_cast<std::int64_t>(offset) * elementVisualLength;
+                result.visualLength = elementVisualLength;
+                return result;
+            }
+            minVisualPos += rangeVisualLength;
+            pos += n.range.length();
+            hideCount += n.pendingHideCount;
+            node = n.right;
+        }
+        return std::optional<AxisGetResult>();
+    }
+
+    // Invoke callable with the AxisGetResult of every element in [first, last]
+    template<typename Callable>
+    void forEach(int first, int last, Callable &&callable) const
+    {
+        forEach(first, last, false, callable);
+    }
+
+    // Invoke callable with the AxisGetResult of every element in [first, last]
+    // taking visual space. Subtrees without visual length are skipped, so
+    // long runs of hidden elements cost nothing
+    template<typename Callable>
+    void forEachVisible(int first, int last, Callable &&callable) const
+    {
+        forEach(first, last, true, callable);
+    }
+
+    std::vector<Range> ranges() const
+    {
+        std::vector<Range> result;
+        collectRanges(m_root, 0, result);
+        return result;
+    }
+
+private:
+    struct Node
+    {
+        Range range;
+        unsigned priority = 0;
+        int left = -1;
+        int right = -1;
+        int length = 0;
+        std::int64_t visualLength = 0;
+        // Smallest hide count of the subtree and the visual length its
+        // elements have when shown
+        int minHideCount = 0;
+        std::int64_t minHideCountVisualLength = 0;
+        // Hide count to add to the children
+        int pendingHideCount = 0;
+    };
+
+    int subtreeLength(int node) const
+    {
+        return node == -1 ? 0 : m_nodes[node].length;
+    }
+
+    std::int64_t subtreeVisualLength(int node) const
+    {
+        return node == -1 ? 0 : m_nodes[node].visualLength;
+    }
+
+    // Visual length of the subtree of node once hideCount is added to it
+    std::int64_t subtreeVisualLength(int node, int hideCount) const
+    {
+        if (node == -1 || m_nodes[node].minHideCount + hideCount > 0)
+            return 0;
+        return m_nodes[node].minHideCountVisualLength;
+    }
+
+    static int visibleElementVisualLength(const Range &range, int hideCount)
+    {
+        return range.hideCount() + hideCount > 0 ? 0 : range.elementVisualLength();
+    }
+
+    void update(int node)
+    {
+        Node &n = m_nodes[node];
+        n.length = subtreeLength(n.left) + n.range.length() + subtreeLength(n.right);
+        n.minHideCount = n.range.hideCount();
+        n.minHideCountVisualLength = static_cast<std::int64_t>(n.range.length()) * n.range.elementVisualLength();
+        for (int child : {n.left, n.right}) {
+            if (child == -1)
+                continue;
+            const Node &c = m_nodes[child];
+            if (c.minHideCount < n.minHideCount) {
+                n.minHideCount = c.minHideCount;
+                n.minHideCountVisualLength = c.minHideCountVisualLength;
+            } else if (c.minHideCount == n.minHideCount) {
+                n.minHideCountVisualLength += c.minHideCountVisualLength;
+            }
+        }
+        n.visualLength = n.minHideCount == 0 ? n.minHideCountVisualLength : 0;
+    }
+
+    // Add hideCount to every range of the subtree of node. The children
+    // get it when they are visited by push()
+    void applyHideCount(int node, int hideCount)
+    {
+        if (node == -1)
+            return;
+        Node &n = m_nodes[node];
+        n.range.setHideCount(n.range.hideCount() + hideCount);
+        n.minHideCount += hideCount;
+        n.pendingHideCount += hideCount;
+        n.visualLength = n.minHideCount == 0 ? n.minHideCountVisualLength : 0;
+    }
+
+    void push(int node)
+    {
+        Node &n = m_nodes[node];
+        if (n.pendingHideCount == 0)
+            return;
+        const int hideCount = n.pendingHideCount;
+        n.pendingHideCount = 0;
+        applyHideCount(n.left, hideCount);
+        applyHideCount(n.right, hideCount);
+    }
+
+    bool addHideCount(int pos, int count, int hideCount)
+    {
+        if (pos < 0 || count < 0 || pos + count > length())
+            return false;
+        int left = -1, middle = -1, right = -1;
+        split(m_root, pos, left, middle);
+        split(middle, count, middle, right);
+        const bool valid = middle == -1 || m_nodes[middle].minHideCount + hideCount >= 0;
+        if (valid)
+            applyHideCount(middle, hideCount);
+        m_root = join(join(left, middle), right);
+        updateUniform();
+        return valid;
+    }
+
+    // Append the ranges of the subtree of node, whose ancestors defer
+    // hideCount to it, to result
+    void collectRanges(int node, int hideCount, std::vector<Range> &result) const
+    {
+        if (node == -1)
+            return;
+        const Node &n = m_nodes[node];
+        collectRanges(n.left, hideCount + n.pendingHideCount, result);
+        result.push_back(Range(n.range.length(), n.range.elementVisualLength(), n.range.hideCount() + hideCount, n.range.fixed()));
+        collectRanges(n.right, hideCount + n.pendingHideCount, result);
+    }
+
+    template<typename Callable>
+    void forEach(int first, int last, bool visibleOnly, Callable &callable) const
+    {
+        first = std::max(first, 0);
+        last = std::min(last, length() - 1);
+        if (first > last || (visibleOnly && m_uniformElementVisualLength == 0))
+            return;
+        if (m_uniformElementVisualLength != -1) {
+            for (int pos = first; pos <= last; ++pos)
+                callable(AxisGetResult(pos, static_cast<std::int64_t>(pos) * m_uniformElementVisualLength, m_uniformElementVisualLength));
+        } else {
+            forEach(m_root, 0, 0, 0, first, last, visibleOnly, callable);
+        }
+    }
+
+    // Visit the elements in [first, last] of the subtree rooted at node,
+    // whose first element has position minPos and visual position
+    // minVisualPos and whose ancestors defer hideCount to it
+    template<typename Callable>
+    void forEach(int node, int hideCount, int minPos, std::int64_t minVisualPos, int first, int last, bool visibleOnly, Callable &callable) const
+    {
+        if (node == -1 || (visibleOnly && subtreeVisualLength(node, hideCount) == 0))
+            return;
+        const Node &n = m_nodes[node];
+        const int childHideCount = hideCount + n.pendingHideCount;
+        const int start = minPos + subtreeLength(n.left);
+        const std::int64_t visualStart = minVisualPos + subtreeVisualLength(n.left, childHideCount);
+        const int end = start + n.range.length();
+        if (first < start)
+            forEach(n.left, childHideCount, minPos, minVisualPos, first, last, visibleOnly, callable);
+        const int elementVisualLength = visibleElementVisualLength(n.range, hideCount);
+        if (!visibleOnly || elementVisualLength > 0) {
+            for (int pos = std::max(first, start); pos < std::min(last + 1, end); ++pos)
+                callable(AxisGetResult(pos, visualStart + static_cast<std::int64_t>(pos - start) * elementVisualLength, elementVisualLength));
+        }
+        if (last >= end)
+            forEach(n.right, childHideCount, end, visualStart + static_cast<std::int64_t>(n.range.length()) * elementVisualLength, first, last, visibleOnly, callable);
+    }
+
+    int createNode(Range range)
+    {
+        int node;
+        if (m_freeNodes.empty()) {
+            node = static_cast<int>(m_nodes.size());
+            m_nodes.push_back(Node{range});
+        } else {
+            node = m_freeNodes.back();
+            m_freeNodes.pop_back();
+            m_nodes[node] = Node{range};
+        }
+        m_nodes[node].priority = m_random();
+        update(node);
+        return node;
+    }
+
+    void destroyTree(int node)
+    {
+        if (node == -1)
+            return;
+        destroyTree(m_nodes[node].left);
+        destroyTree(m_nodes[node].right);
+        m_freeNodes.push_back(node);
+    }
+
+    // Split the tree in two trees holding respectively the first pos
+    // elements and the remaining ones. A range containing the split
+    // position is cut in two ranges
+    void split(int node, int pos, int &left, int &right)
+    {
+        if (node == -1) {
+            left = right = -1;
+            return;
+        }
+        // Children are split into locals since splitting a range may
+        // allocate a node and invalidate references into m_nodes
+        push(node);
+        const int leftLength = subtreeLength(m_nodes[node].left);
+        const int rangeLength = m_nodes[node].range.length();
+        if (pos <= leftLength) {
+            int child = -1;
+            split(m_nodes[node].left, pos, left, child);
+            m_nodes[node].left = child;
+            right = node;
+        } else if (pos >= leftLength + rangeLength) {
+            int child = -1;
+            split(m_nodes[node].right, pos - leftLength - rangeLength, child, right);
+            m_nodes[node].right = child;
+            left = node;
+        } else {
+            const int offset = pos - leftLength;
+            const int tail = createNode(m_nodes[node].range.resized(rangeLength - offset));
+            m_nodes[node].range.resize(offset);
+            right = merge(tail, m_nodes[node].right);
+            m_nodes[node].right = -1;
+            left = node;
+        }
+        update(node);
+    }
+
+    int merge(int left, int right)
+    {
+        if (left == -1)
+            return right;
+        if (right == -1)
+            return left;
+        if (m_nodes[left].priority > m_nodes[right].priority) {
+            push(left);
+            const int child = merge(m_nodes[left].right, right);
+            m_nodes[left].right = child;
+            update(left);
+            return left;
+        } else {
+            push(right);
+            const int child = merge(left, m_nodes[right].left);
+            m_nodes[right].left = child;
+            update(right);
+            return right;
+        }
+    }
+
+    // Merge two trees joining the last range of left with the first
+    // range of right when they have the same element visual length
+    int join(int left, int right)
+    {
+        if (left == -1)
+            return right;
+        if (right == -1)
+            return left;
+        int last = left;
+        for (push(last); m_nodes[last].right != -1; push(last))
+            last = m_nodes[last].right;
+        int first = right;
+        for (push(first); m_nodes[first].left != -1; push(first))
+            first = m_nodes[first].left;
+        if (m_nodes[last].range.hasSameElements(m_nodes[first].range)) {
+            const int count = m_nodes[first].range.length();
+            int head = -1;
+            split(right, count, head, right);
+            destroyTree(head);
+            growLast(left, count);
+        }
+        return merge(left, right);
+    }
+
+    // Add count elements to the last range of the tree
+    void growLast(int node, int count)
+    {
+        push(node);
+        const int right = m_nodes[node].right;
+        if (right == -1)
+            m_nodes[node].range.resize(m_nodes[node].range.length() + count);
+        else
+            growLast(right, count);
+        update(node);
+    }
+
+    // Replace count elements starting from pos with the elements of range
+    void replace(int pos, int count, Range range)
+    {
+        int left = -1, middle = -1, right = -1;
+        split(m_root, pos, left, middle);
+        split(middle, count, middle, right);
+        destroyTree(middle);
+        if (!range.empty()) {
+            const int node = createNode(range);
+            left = join(left, node);
+        }
+        m_root = join(left, right);
+        updateUniform();
+    }
+
+    void updateUniform()
+    {
+        const bool uniform = m_root != -1 && m_nodes[m_root].left == -1 && m_nodes[m_root].right == -1;
+        m_uniformElementVisualLength = uniform ? m_nodes[m_root].range.visibleElementVisualLength() : -1;
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<int> m_freeNodes;
+    std::minstd_rand m_random;
+    int m_root = -1;
+    // Visual length of every element when the axis holds a single range, -1 otherwise
+    int m_uniformElementVisualLength = -1;
+};
@@ -0,0 +1,212 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+/*
+    TreeRows lays out the rows of a tree in depth first order, every row
+    being followed by the rows of its descendants. A row knows its parent,
+    its row among its siblings, its depth and its number of descendants,
+    so a subtree is the contiguous run of rows starting at its root.
+
+    Below a parent, the rows are ordered by the row among its siblings of
+    their ancestor that is a child of the parent. The row of a child is
+    found by a binary search on that order, walking up from the rows
+    probed, in O(log n * depth).
+
+    Rows are collapsed by default. Hiding the descendants of a collapsed
+    row is left to the hide counts of the row axis: the hide count of a
+    row is the number of its collapsed ancestors. Expanding and collapsing
+    therefore only flip a flag here.
+
+    The rows are stored in a vector, so insert and remove shift the rows
+    that follow and fix their parent links, in O(n) where n is the number
+    of rows. Building the rows of a whole model is linear as well.
+*/
+class TreeRows
+{
+public:
+    struct Node
+    {
+        int parent = -1;
+        int modelRow = 0;
+        int depth = 0;
+        int descendants = 0;
+        bool expanded = false;
+    };
+
+    int size() const
+    {
+        return static_cast<int>(m_nodes.size());
+    }
+
+    bool empty() const
+    {
+        return m_nodes.empty();
+    }
+
+    void clear()
+    {
+        m_nodes.clear();
+    }
+
+    const Node &node(int row) const
+    {
+        return m_nodes[row];
+    }
+
+    void setExpanded(int row, bool expanded)
+    {
+        m_nodes[row].expanded = expanded;
+    }
+
+    // Return the row of the child at modelRow of parent, -1 being the
+    // root, or -1 if there is no such child
+    int childRow(int parent, int modelRow) const
+    {
+        const int depth = parent == -1 ? 0 : m_nodes[parent].depth + 1;
+        const int end = subtreeEnd(parent);
+        int first = parent + 1;
+        int last = end;
+        while (first < last) {
+            const int middle = first + (last - first) / 2;
+            if (m_nodes[ancestorAt(middle, depth)].modelRow < modelRow)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        if (first == end || m_nodes[first].depth != depth || m_nodes[first].modelRow != modelRow)
+            return -1;
+        return first;
+    }
+
+    // Return the row at the end of the path of rows among siblings from
+    // the top level, or -1 if there is none
+    int find(const std::vector<int> &path) const
+    {
+        int row = -1;
+        for (int modelRow : path) {
+            row = childRow(row, modelRow);
+            if (row == -1)
+                return -1;
+        }
+        return row;
+    }
+
+    // Return the rows among siblings from the top level down to row
+    std::vector<int> path(int row) const
+    {
+        std::vector<int> result(m_nodes[row].depth + 1);
+        for (; row != -1; row = m_nodes[row].parent)
+            result[m_nodes[row].depth] = m_nodes[row].modelRow;
+        return result;
+    }
+
+    // Return the number of collapsed rows among row and its ancestors
+    int collapsedCount(int row) const
+    {
+        int count = 0;
+        for (; row != -1; row = m_nodes[row].parent)
+            count += m_nodes[row].expanded ? 0 : 1;
+        return count;
+    }
+
+    // Return the row after the last descendant of row, -1 being the root
+    int subtreeEnd(int row) const
+    {
+        return row == -1 ? size() : row + m_nodes[row].descendants + 1;
+    }
+
+    // Insert the subtrees of nodes as children of parent before its child
+    // at modelRow, or after the last one. Nodes are given in depth first
+    // order with their modelRow and their depth relative to the children
+    // of parent, the other fields are computed. Returns the first row.
+    // Linear in the number of rows
+    int insert(int parent, int modelRow, std::vector<Node> nodes)
+    {
+        const int count = static_cast<int>(nodes.size());
+        const int end = subtreeEnd(parent);
+        int first = childRow(parent, modelRow);
+        if (first == -1)
+            first = end;
+
+        // Links into the rows that follow the insertion point move with them
+        int siblings = 0;
+        for (const Node &node : nodes)
+            siblings += node.depth == 0 ? 1 : 0;
+        for (int row = first; row < size(); ++row)
+            if (m_nodes[row].parent >= first)
+                m_nodes[row].parent += count;
+        for (int row = first; row < end; row += m_nodes[row].descendants + 1)
+            m_nodes[row].modelRow += siblings;
+        for (int row = parent; row != -1; row = m_nodes[row].parent)
+            m_nodes[row].descendants += count;
+
+        // The stack holds the open subtrees, which close at the next row
+        // that is not deeper
+        const int baseDepth = parent == -1 ? 0 : m_nodes[parent].depth + 1;
+        std::vector<int> stack;
+        for (int i = 0; i <= count; ++i) {
+            const int depth = i < count ? nodes[i].depth : 0;
+            while (static_cast<int>(stack.size()) > depth) {
+                nodes[stack.back()].descendants = i - stack.back() - 1;
+                stack.pop_back();
+            }
+            if (i == count)
+                break;
+            nodes[i].parent = stack.empty() ? parent : first + stack.back();
+            nodes[i].depth = baseDepth + depth;
+            nodes[i].expanded = false;
+            stack.push_back(i);
+        }
+        m_nodes.insert(m_nodes.begin() + first, nodes.begin(), nodes.end());
+        return first;
+    }
+
+    // Remove count rows starting at row, which must be whole subtrees of
+    // consecutive siblings. Linear in the number of rows
+    void remove(int row, int count)
+    {
+        const int parent = m_nodes[row].parent;
+        const int end = subtreeEnd(parent);
+        int siblings = 0;
+        for (int i = row; i < row + count; i += m_nodes[i].descendants + 1)
+            ++siblings;
+        for (int i = row + count; i < end; i += m_nodes[i].descendants + 1)
+            m_nodes[i].modelRow -= siblings;
+        for (int i = parent; i != -1; i = m_nodes[i].parent)
+            m_nodes[i].descendants -= count;
+
+        m_nodes.erase(m_nodes.begin() + row, m_nodes.begin() + row + count);
+        for (int i = row; i < size(); ++i)
+            if (m_nodes[i].parent >= row)
+                m_nodes[i].parent -= count;
+    }
+
+private:
+    int ancestorAt(int row, int depth) const
+    {
+        while (m_nodes[row].depth > depth)
+            row = m_nodes[row].parent;
+        return row;
+    }
+
+    std::vector<Node> m_nodes;
+};
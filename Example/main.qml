@@ -28,6 +28,8 @@ ApplicationWindow {
 
     TableView {
         anchors.fill: parent
+        rowCount: 1000
+        columnCount: 1000
         cellDelegate: Rectangle {
             color: "yellow"
             width: 100
@@ -0,0 +1,233 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtTest>
+
+#include <axis.h>
+#include <table.h>
+#include <treeaxis.h>
+
+class AdvancedViewsBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void benchmarkAxisGet_data();
+    void benchmarkAxisGet();
+    void benchmarkAxisVisualGet_data();
+    void benchmarkAxisVisualGet();
+    void benchmarkAxisLength_data();
+    void benchmarkAxisLength();
+    void benchmarkAxisInsertAt_data();
+    void benchmarkAxisInsertAt();
+    void benchmarkTreeAxisInsertAt_data();
+    void benchmarkTreeAxisInsertAt();
+    void benchmarkTreeAxisSetVisualLength_data();
+    void benchmarkTreeAxisSetVisualLength();
+    void benchmarkTableCellsInRect();
+    void benchmarkTableCellsInRectBuffer();
+
+private:
+    static void addRangeCountRows();
+    static Axis createAxis(int numRanges);
+    static void addElementCountRows();
+    template<typename AxisType>
+    static void insertElements(AxisType &axis, int numElements);
+    template<typename AxisType>
+    static void resizeElements(AxisType &axis);
+    static void createTable(Table &table);
+};
+
+void AdvancedViewsBenchmark::addRangeCountRows()
+{
+    QTest::addColumn<int>("numRanges");
+    QTest::newRow("10 ranges") << 10;
+    QTest::newRow("100 ranges") << 100;
+    QTest::newRow("1000 ranges") << 1000;
+    QTest::newRow("10000 ranges") << 10000;
+}
+
+Axis AdvancedViewsBenchmark::createAxis(int numRanges)
+{
+    // Alternate the element length so every element is its own range
+    Axis axis;
+    for (int i = 0; i < numRanges; ++i)
+        axis.append(i % 2 == 0 ? 100 : 50);
+    return axis;
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisGet_data()
+{
+    addRangeCountRows();
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisGet()
+{
+    QFETCH(int, numRanges);
+    const Axis axis = createAxis(numRanges);
+    std::int64_t sum = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i)
+            sum += axis.get((i * 7919) % numRanges)->visualPos;
+    }
+    QVERIFY(sum >= 0);
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisVisualGet_data()
+{
+    addRangeCountRows();
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisVisualGet()
+{
+    QFETCH(int, numRanges);
+    const Axis axis = createAxis(numRanges);
+    const std::int64_t visualLength = axis.visualLength();
+    int sum = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i)
+            sum += axis.visualGet((i * 7919) % visualLength)->pos;
+    }
+    QVERIFY(sum >= 0);
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisLength_data()
+{
+    addRangeCountRows();
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisLength()
+{
+    QFETCH(int, numRanges);
+    const Axis axis = createAxis(numRanges);
+    int sum = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i)
+            sum += axis.length() + axis.visualLength();
+    }
+    QVERIFY(sum > 0);
+}
+
+void AdvancedViewsBenchmark::addElementCountRows()
+{
+    QTest::addColumn<int>("numElements");
+    QTest::newRow("1000 elements") << 1000;
+    QTest::newRow("10000 elements") << 10000;
+    QTest::newRow("20000 elements") << 20000;
+}
+
+template<typename AxisType>
+void AdvancedViewsBenchmark::insertElements(AxisType &axis, int numElements)
+{
+    for (int i = 0; i < numElements; ++i)
+        axis.insertAt((i * 7919) % (axis.length() + 1), i % 2 == 0 ? 100 : 50);
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisInsertAt_data()
+{
+    addElementCountRows();
+}
+
+void AdvancedViewsBenchmark::benchmarkAxisInsertAt()
+{
+    QFETCH(int, numElements);
+    QBENCHMARK {
+        Axis axis;
+        insertElements(axis, numElements);
+    }
+}
+
+void AdvancedViewsBenchmark::benchmarkTreeAxisInsertAt_data()
+{
+    addElementCountRows();
+}
+
+void AdvancedViewsBenchmark::benchmarkTreeAxisInsertAt()
+{
+    QFETCH(int, numElements);
+    QBENCHMARK {
+        TreeAxis axis;
+        insertElements(axis, numElements);
+    }
+}
+
+template<typename AxisType>
+void AdvancedViewsBenchmark::resizeElements(AxisType &axis)
+{
+    // Simulate a drag resize of the element in the middle of the axis
+    const int pos = axis.length() / 2;
+    for (int i = 0; i < 1000; ++i)
+        axis.setVisualLength(pos, 20 + i % 100);
+}
+
+void AdvancedViewsBenchmark::benchmarkTreeAxisSetVisualLength_data()
+{
+    addRangeCountRows();
+}
+
+void AdvancedViewsBenchmark::benchmarkTreeAxisSetVisualLength()
+{
+    QFETCH(int, numRanges);
+    TreeAxis axis;
+    for (int i = 0; i < numRanges; ++i)
+        axis.append(i % 2 == 0 ? 100 : 50);
+    QBENCHMARK {
+        resizeElements(axis);
+    }
+}
+
+void AdvancedViewsBenchmark::createTable(Table &table)
+{
+    // A million of small cells with some rows and columns resized
+    table.xAxis().insertAt(0, Range(1000, 20));
+    table.yAxis().insertAt(0, Range(1000, 20));
+    for (int i = 0; i < 1000; i += 7) {
+        table.xAxis().setVisualLength(i, 30);
+        table.yAxis().setVisualLength(i, 15);
+    }
+}
+
+void AdvancedViewsBenchmark::benchmarkTableCellsInRect()
+{
+    Table table;
+    createTable(table);
+    const QRect viewport(5000, 5000, 3840, 2160);
+    std::size_t numCells = 0;
+    QBENCHMARK {
+        numCells += table.cellsInVisualRect(viewport).size();
+    }
+    QVERIFY(numCells > 0);
+}
+
+void AdvancedViewsBenchmark::benchmarkTableCellsInRectBuffer()
+{
+    Table table;
+    createTable(table);
+    const QRect viewport(5000, 5000, 3840, 2160);
+    std::vector<Cell> cells;
+    std::size_t numCells = 0;
+    QBENCHMARK {
+        table.cellsInVisualRect(viewport, cells);
+        numCells += cells.size();
+    }
+    QVERIFY(numCells > 0);
+}
+
+QTEST_APPLESS_MAIN(AdvancedViewsBenchmark)
+
+#include "bench_advancedviews.moc"
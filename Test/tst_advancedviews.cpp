@@ -20,7 +20,18 @@
 #include <iostream>
 
 #include <axis.h>
+#include <cellhash.h>
+#include <overscan.h>
+#include <permutation.h>
+#include <spanindex.h>
 #include <table.h>
+#include <treeaxis.h>
+#include <treerows.h>
+
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
 
 // add necessary includes here
 
@@ -36,6 +47,7 @@ private slots:
     void testAxisAppend();
     void testAxisGet();
     void testAxisVisualGet();
+    void testAxisGetManyRanges();
     void testAxisLength();
     void testAxisVisualLength();
     void testAxisRemoveAt();
@@ -43,9 +55,52 @@ private slots:
     void testAxisMixed();
     void testAxisInsertAt();
     void testAxisMove();
+    void testAxisMoveSpan();
+    void testAxisAppendVector();
+    void testAxisBulkInsertAt();
+    void testAxisBulkRemoveAt();
+    void testAxisForEach();
+    void testAxisPermute();
+    void testAxisBulkSetVisualLength();
+
+    void testTreeAxisInsertAt();
+    void testTreeAxisRemoveAt();
+    void testTreeAxisMove();
+    void testTreeAxisBulkSetVisualLength();
+    void testTreeAxisSetVisualLength();
+    void testTreeAxisDefaultVisualLength();
+    void testTreeAxisMatchesAxis();
+    void testTreeAxisUniform();
+    void testTreeAxisHide();
+    void testTreeAxisLarge();
+
+    void testCellHash();
+    void testCellHashMatchesMap();
+
+    void testPermutation();
+    void testPermutationMatchesVector();
+
+    void testTreeRows();
+    void testTreeRowsMatchesTree();
+
+    void testSpanIndex();
+    void testSpanIndexMatchesBruteForce();
+
+    void testOverscanSplit();
+    void testOverscanArea();
 
     void testTableBoundingRect();
     void testTableCellsInRect();
+    void testTableCellsInRectBuffer();
+    void testTableIndexesInRect();
+    void testTableCellsInIndexRect();
+    void testTableCellAt();
+    void testTableOrigin();
+    void testTableSpans();
+    void testTableSpansInsert();
+    void testTableSpansRemove();
+    void testTableSpansMove();
+    void testTableHidden();
 };
 
 AdvancedViewsTest::AdvancedViewsTest()
@@ -100,6 +155,26 @@ void AdvancedViewsTest::testAxisVisualGet()
     QVERIFY(!axis.visualGet(250));
 }
 
+void AdvancedViewsTest::testAxisGetManyRanges()
+{
+    Axis axis;
+    for (int i = 0; i < 100; ++i)
+        axis.append(i % 2 == 0 ? 100 : 50);
+    QVERIFY(axis.m_ranges.size() == 100);
+    QCOMPARE(axis.length(), 100);
+    QCOMPARE(axis.visualLength(), std::int64_t(7500));
+    for (int i = 0; i < 100; ++i) {
+        const int visualPos = (i / 2) * 150 + (i % 2 == 0 ? 0 : 100);
+        const int visualLength = i % 2 == 0 ? 100 : 50;
+        QVERIFY(axis.get(i) == AxisGetResult(i, visualPos, visualLength));
+        QVERIFY(axis.visualGet(visualPos) == AxisGetResult(i, visualPos, visualLength));
+        QVERIFY(axis.visualGet(visualPos + visualLength - 1) == AxisGetResult(i, visualPos, visualLength));
+    }
+    QVERIFY(!axis.get(100));
+    QVERIFY(!axis.visualGet(7500));
+    QVERIFY(!axis.visualGet(-1));
+}
+
 void AdvancedViewsTest::testAxisLength()
 {
     Axis axis;
@@ -117,15 +192,15 @@ void AdvancedViewsTest::testAxisLength()
 void AdvancedViewsTest::testAxisVisualLength()
 {
     Axis axis;
-    QCOMPARE(axis.visualLength(), 0);
+    QCOMPARE(axis.visualLength(), std::int64_t(0));
     axis.append(100);
-    QCOMPARE(axis.visualLength(), 100);
+    QCOMPARE(axis.visualLength(), std::int64_t(100));
     axis.append(50);
-    QCOMPARE(axis.visualLength(), 150);
+    QCOMPARE(axis.visualLength(), std::int64_t(150));
     axis.append(100);
-    QCOMPARE(axis.visualLength(), 250);
+    QCOMPARE(axis.visualLength(), std::int64_t(250));
     axis.append(100);
-    QCOMPARE(axis.visualLength(), 350);
+    QCOMPARE(axis.visualLength(), std::int64_t(350));
 }
 
 void AdvancedViewsTest::testAxisRemoveAt()
@@ -212,6 +287,10 @@ void AdvancedViewsTest::testAxisMixed()
     axis.removeAt(2);
     test = {Range(1, 100), Range(2, 50), Range(1, 100)};
     QVERIFY(std::equal(axis.m_ranges.begin(), axis.m_ranges.end(), test.begin()));
+
+    axis.removeAt(0);
+    test = {Range(2, 50), Range(1, 100)};
+    QVERIFY(axis.m_ranges == test);
 }
 
 void AdvancedViewsTest::testAxisInsertAt()
@@ -283,6 +362,955 @@ void AdvancedViewsTest::testAxisMove()
     QVERIFY(axis.m_ranges == test);
 }
 
+void AdvancedViewsTest::testAxisMoveSpan()
+{
+    Axis axis;
+    axis.append({100, 100, 50, 50, 75, 75});
+
+    std::vector<Range> test = {Range(2, 100), Range(2, 50), Range(2, 75)};
+    QVERIFY(!axis.move(-1, 2, 0));
+    QVERIFY(!axis.move(5, 2, 0));
+    QVERIFY(!axis.move(0, 2, 7));
+    QVERIFY(axis.move(1, 2, 2));
+    QVERIFY(axis.move(1, 2, 3));
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.move(1, 2, 5));
+    test = {Range(1, 100), Range(1, 50), Range(1, 75), Range(1, 100), Range(1, 50), Range(1, 75)};
+    QVERIFY(axis.m_ranges == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(450));
+
+    QVERIFY(axis.move(3, 2, 1));
+    test = {Range(2, 100), Range(2, 50), Range(2, 75)};
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.move(4, 2, 0));
+    test = {Range(2, 75), Range(2, 100), Range(2, 50)};
+    QVERIFY(axis.m_ranges == test);
+    QVERIFY(axis.get(2) == AxisGetResult(2, 150, 100));
+}
+
+void AdvancedViewsTest::testAxisAppendVector()
+{
+    Axis axis;
+    axis.append(100);
+    axis.append({100, 100, 50, 50, 100});
+    std::vector<Range> test = {Range(3, 100), Range(2, 50), Range(1, 100)};
+    QVERIFY(axis.m_ranges == test);
+    QCOMPARE(axis.length(), 6);
+    QCOMPARE(axis.visualLength(), std::int64_t(500));
+
+    axis.append(std::vector<int>());
+    QVERIFY(axis.m_ranges == test);
+}
+
+void AdvancedViewsTest::testAxisBulkInsertAt()
+{
+    Axis axis;
+
+    std::vector<Range> test = {};
+    QVERIFY(!axis.insertAt(-1, Range(2, 100)));
+    QVERIFY(!axis.insertAt(1, Range(2, 100)));
+    QVERIFY(!axis.insertAt(0, Range(-1, 100)));
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.insertAt(0, Range(1000000, 100)));
+    test = {Range(1000000, 100)};
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.insertAt(10, Range(5, 50)));
+    test = {Range(10, 100), Range(5, 50), Range(999990, 100)};
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.insertAt(15, Range(5, 100)));
+    test = {Range(10, 100), Range(5, 50), Range(999995, 100)};
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.insertAt(0, Range(0, 50)));
+    QVERIFY(axis.m_ranges == test);
+    QCOMPARE(axis.length(), 1000010);
+}
+
+void AdvancedViewsTest::testAxisBulkRemoveAt()
+{
+    Axis axis;
+    axis.append({100, 100, 50, 50, 75, 100, 100});
+
+    std::vector<Range> test = {Range(2, 100), Range(2, 50), Range(1, 75), Range(2, 100)};
+    QVERIFY(!axis.removeAt(-1, 1));
+    QVERIFY(!axis.removeAt(0, -1));
+    QVERIFY(!axis.removeAt(5, 3));
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.removeAt(3, 0));
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.removeAt(1, 5));
+    test = {Range(2, 100)};
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.removeAt(0, 2));
+    test = {};
+    QVERIFY(axis.m_ranges == test);
+    QCOMPARE(axis.length(), 0);
+    QCOMPARE(axis.visualLength(), std::int64_t(0));
+}
+
+void AdvancedViewsTest::testAxisForEach()
+{
+    Axis axis;
+    axis.append({100, 100, 50, 75, 75});
+
+    std::vector<AxisGetResult> results;
+    auto collect = [&results](const AxisGetResult &result) { results.push_back(result); };
+
+    axis.forEach(0, 4, collect);
+    std::vector<AxisGetResult> test = {AxisGetResult(0, 0, 100), AxisGetResult(1, 100, 100),
+                                       AxisGetResult(2, 200, 50), AxisGetResult(3, 250, 75),
+                                       AxisGetResult(4, 325, 75)};
+    QVERIFY(results == test);
+
+    results.clear();
+    axis.forEach(1, 3, collect);
+    test = {AxisGetResult(1, 100, 100), AxisGetResult(2, 200, 50), AxisGetResult(3, 250, 75)};
+    QVERIFY(results == test);
+
+    results.clear();
+    axis.forEach(-5, 0, collect);
+    axis.forEach(4, 10, collect);
+    axis.forEach(3, 2, collect);
+    test = {AxisGetResult(0, 0, 100), AxisGetResult(4, 325, 75)};
+    QVERIFY(results == test);
+}
+
+void AdvancedViewsTest::testAxisPermute()
+{
+    Axis axis;
+    TreeAxis treeAxis;
+    axis.append({10, 20, 20, 30, 10});
+    treeAxis.append({10, 20, 20, 30, 10});
+    QVERIFY(!axis.permute({0, 1, 2}));
+    QVERIFY(!treeAxis.permute({0, 1, 2, 2, 4}));
+
+    QVERIFY(axis.permute({4, 0, 3, 1, 2}));
+    QVERIFY(treeAxis.permute({4, 0, 3, 1, 2}));
+    std::vector<Range> test = {Range(2, 10), Range(1, 30), Range(2, 20)};
+    QVERIFY(axis.m_ranges == test);
+    QVERIFY(treeAxis.ranges() == test);
+    QCOMPARE(treeAxis.visualLength(), std::int64_t(90));
+
+    // A uniform axis is left as is
+    TreeAxis uniform;
+    uniform.insertAt(0, Range(1000000, 20));
+    std::vector<int> order(1000000);
+    std::iota(order.rbegin(), order.rend(), 0);
+    QVERIFY(uniform.permute(order));
+    QCOMPARE(uniform.ranges().size(), std::size_t(1));
+}
+
+void AdvancedViewsTest::testAxisBulkSetVisualLength()
+{
+    Axis axis;
+    axis.insertAt(0, Range(10, 100));
+
+    std::vector<Range> test = {Range(10, 100)};
+    QVERIFY(!axis.setVisualLength(-1, 1, 50));
+    QVERIFY(!axis.setVisualLength(8, 3, 50));
+    QVERIFY(axis.m_ranges == test);
+
+    QVERIFY(axis.setVisualLength(2, 3, 50));
+    test = {Range(2, 100), Range(3, 50, 0, true), Range(5, 100)};
+    QVERIFY(axis.m_ranges == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(850));
+
+    QVERIFY(axis.setVisualLength(4, 2, 50));
+    test = {Range(2, 100), Range(4, 50, 0, true), Range(4, 100)};
+    QVERIFY(axis.m_ranges == test);
+
+    axis.hide(0, 3);
+    QVERIFY(axis.setVisualLength(0, 10, 25));
+    test = {Range(3, 25, 1, true), Range(7, 25, 0, true)};
+    QVERIFY(axis.m_ranges == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(175));
+}
+
+void AdvancedViewsTest::testTreeAxisInsertAt()
+{
+    TreeAxis axis;
+
+    std::vector<Range> test = {};
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(!axis.insertAt(-1, 100));
+    QVERIFY(!axis.insertAt(1, 100));
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.insertAt(0, 100));
+    test = {Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    axis.insertAt(0, 50);
+    test = {Range(1, 50), Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    axis.insertAt(1, 75);
+    test = {Range(1, 50), Range(1, 75), Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    axis.insertAt(1, 75);
+    axis.insertAt(1, 75);
+    test = {Range(1, 50), Range(3, 75), Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    axis.insertAt(2, 50);
+    test = {Range(1, 50), Range(1, 75), Range(1, 50), Range(2, 75), Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    QCOMPARE(axis.length(), 6);
+    QCOMPARE(axis.visualLength(), std::int64_t(425));
+    QVERIFY(axis.get(3) == AxisGetResult(3, 175, 75));
+    QVERIFY(axis.visualGet(260) == AxisGetResult(4, 250, 75));
+}
+
+void AdvancedViewsTest::testTreeAxisRemoveAt()
+{
+    TreeAxis axis;
+    axis.append(100);
+    axis.append(50);
+    axis.append(100);
+    axis.append(100);
+
+    std::vector<Range> test = {Range(1, 100), Range(1, 50), Range(2, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(!axis.removeAt(-1));
+    QVERIFY(!axis.removeAt(4));
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.removeAt(3));
+    test = {Range(1, 100), Range(1, 50), Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.removeAt(1));
+    test = {Range(2, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.visualRemoveAt(150));
+    test = {Range(1, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.removeAt(0));
+    test = {};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.length(), 0);
+    QCOMPARE(axis.visualLength(), std::int64_t(0));
+}
+
+void AdvancedViewsTest::testTreeAxisMove()
+{
+    TreeAxis axis;
+    axis.append(100);
+    axis.append(100);
+    axis.append(50);
+    axis.append(50);
+
+    std::vector<Range> test = { Range(2, 100), Range(2, 50) };
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(!axis.move(0, -1));
+    QVERIFY(!axis.move(0, 5));
+    QVERIFY(!axis.move(4, 0));
+
+    axis.move(0, 3);
+    test = { Range(1, 100), Range(1, 50), Range(1, 100), Range(1, 50)};
+    QVERIFY(axis.ranges() == test);
+
+    axis.move(2, 4);
+    test = { Range(1, 100), Range(2, 50), Range(1, 100) };
+    QVERIFY(axis.ranges() == test);
+
+    axis.move(3, 0);
+    test = { Range(2, 100), Range(2, 50) };
+    QVERIFY(axis.ranges() == test);
+}
+
+void AdvancedViewsTest::testTreeAxisBulkSetVisualLength()
+{
+    TreeAxis axis;
+    axis.insertAt(0, Range(10, 100));
+
+    std::vector<Range> test = {Range(10, 100)};
+    QVERIFY(!axis.setVisualLength(-1, 1, 50));
+    QVERIFY(!axis.setVisualLength(8, 3, 50));
+    QVERIFY(axis.ranges() == test);
+
+    // Resized elements are fixed and are not merged with the others
+    QVERIFY(axis.setVisualLength(2, 3, 50));
+    test = {Range(2, 100), Range(3, 50, 0, true), Range(5, 100)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(850));
+
+    QVERIFY(axis.setVisualLength(4, 2, 50));
+    test = {Range(2, 100), Range(4, 50, 0, true), Range(4, 100)};
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.setVisualLength(0, 10, 25));
+    test = {Range(10, 25, 0, true)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(250));
+}
+
+void AdvancedViewsTest::testTreeAxisSetVisualLength()
+{
+    auto fixed = [](int numElements, int elementVisualLength) {
+        return Range(numElements, elementVisualLength, 0, true);
+    };
+    TreeAxis axis;
+    axis.insertAt(0, fixed(3, 100));
+    axis.insertAt(3, fixed(1, 50));
+    axis.insertAt(4, fixed(1, 100));
+
+    std::vector<Range> test = {fixed(3, 100), fixed(1, 50), fixed(1, 100)};
+    QVERIFY(!axis.setVisualLength(-1, 50));
+    QVERIFY(!axis.setVisualLength(5, 50));
+    QVERIFY(axis.ranges() == test);
+
+    QVERIFY(axis.setVisualLength(1, 75));
+    test = {fixed(1, 100), fixed(1, 75), fixed(1, 100), fixed(1, 50), fixed(1, 100)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(425));
+    QVERIFY(axis.get(4) == AxisGetResult(4, 325, 100));
+
+    QVERIFY(axis.setVisualLength(2, 50));
+    test = {fixed(1, 100), fixed(1, 75), fixed(2, 50), fixed(1, 100)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(375));
+    QVERIFY(axis.visualGet(300) == AxisGetResult(4, 275, 100));
+
+    QVERIFY(axis.setVisualLength(1, 100));
+    test = {fixed(2, 100), fixed(2, 50), fixed(1, 100)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(400));
+
+    QVERIFY(axis.setVisualLength(4, 50));
+    test = {fixed(2, 100), fixed(3, 50)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(350));
+    QVERIFY(axis.get(4) == AxisGetResult(4, 300, 50));
+}
+
+void AdvancedViewsTest::testTreeAxisDefaultVisualLength()
+{
+    TreeAxis axis;
+    axis.insertAt(0, Range(10, 100));
+    QVERIFY(axis.setVisualLength(2, 2, 50));
+    QVERIFY(axis.hide(5, 2));
+
+    // Only the elements that are not fixed follow the default, and the
+    // hidden ones keep being hidden
+    axis.setDefaultVisualLength(20);
+    std::vector<Range> test = {Range(2, 20), Range(2, 50, 0, true), Range(1, 20), Range(2, 20, 1), Range(3, 20)};
+    QVERIFY(axis.ranges() == test);
+    QCOMPARE(axis.visualLength(), std::int64_t(6 * 20 + 2 * 50));
+    QVERIFY(axis.get(4) == AxisGetResult(4, 140, 20));
+
+    // Elements set to the default are still fixed
+    QVERIFY(axis.setVisualLength(0, 1, 20));
+    axis.setDefaultVisualLength(30);
+    test = {Range(1, 20, 0, true), Range(1, 30), Range(2, 50, 0, true), Range(1, 30), Range(2, 30, 1), Range(3, 30)};
+    QVERIFY(axis.ranges() == test);
+    QVERIFY(axis.show(5, 2));
+    QCOMPARE(axis.visualLength(), std::int64_t(20 + 7 * 30 + 2 * 50));
+
+    test = {Range(1, 20, 0, true), Range(1, 30), Range(2, 50, 0, true), Range(6, 30)};
+    QVERIFY(axis.ranges() == test);
+}
+
+void AdvancedViewsTest::testTreeAxisUniform()
+{
+    TreeAxis axis;
+    axis.insertAt(0, Range(1000000, 20));
+    QCOMPARE(axis.m_uniformElementVisualLength, 20);
+    QCOMPARE(*axis.get(123456), AxisGetResult(123456, 2469120, 20));
+    QCOMPARE(*axis.visualGet(2469139), AxisGetResult(123456, 2469120, 20));
+    QVERIFY(!axis.get(1000000));
+    QVERIFY(!axis.visualGet(20000000));
+
+    std::vector<AxisGetResult> results;
+    axis.forEach(999998, 1000005, [&](const AxisGetResult &result) { results.push_back(result); });
+    std::vector<AxisGetResult> test = { AxisGetResult(999998, 19999960, 20), AxisGetResult(999999, 19999980, 20) };
+    QVERIFY(results == test);
+
+    // Resizing an element switches to the tree lookups
+    axis.setVisualLength(10, 30);
+    QCOMPARE(axis.m_uniformElementVisualLength, -1);
+    QCOMPARE(*axis.get(11), AxisGetResult(11, 230, 20));
+    QCOMPARE(*axis.visualGet(215), AxisGetResult(10, 200, 30));
+
+    // Resizing every element to the same length switches back
+    axis.setVisualLength(0, axis.length(), 20);
+    QCOMPARE(axis.m_uniformElementVisualLength, 20);
+    QCOMPARE(*axis.get(11), AxisGetResult(11, 220, 20));
+
+    axis.removeAt(0, axis.length());
+    QCOMPARE(axis.m_uniformElementVisualLength, -1);
+    QVERIFY(!axis.get(0));
+}
+
+void AdvancedViewsTest::testTreeAxisLarge()
+{
+    // 300 million rows of 100 pixels, far beyond the int range
+    TreeAxis axis;
+    axis.insertAt(0, Range(300000000, 100));
+    QCOMPARE(axis.visualLength(), std::int64_t(30000000000));
+    QCOMPARE(*axis.get(299999999), AxisGetResult(299999999, 29999999900, 100));
+    QCOMPARE(*axis.visualGet(29999999999), AxisGetResult(299999999, 29999999900, 100));
+
+    // Same lookups through the tree
+    axis.setVisualLength(0, 50);
+    QCOMPARE(axis.visualLength(), std::int64_t(29999999950));
+    QCOMPARE(*axis.get(250000000), AxisGetResult(250000000, 24999999950, 100));
+    QCOMPARE(*axis.visualGet(24999999950), AxisGetResult(250000000, 24999999950, 100));
+
+    std::vector<AxisGetResult> results;
+    axis.forEach(299999998, 299999999, [&](const AxisGetResult &result) { results.push_back(result); });
+    std::vector<AxisGetResult> test = { AxisGetResult(299999998, 29999999750, 100), AxisGetResult(299999999, 29999999850, 100) };
+    QVERIFY(results == test);
+
+    Axis vectorAxis;
+    vectorAxis.insertAt(0, Range(299999999, 100));
+    vectorAxis.insertAt(0, Range(1, 50));
+    QCOMPARE(vectorAxis.visualLength(), std::int64_t(29999999950));
+    QCOMPARE(*vectorAxis.get(250000000), AxisGetResult(250000000, 24999999950, 100));
+    QCOMPARE(*vectorAxis.visualGet(24999999950), AxisGetResult(250000000, 24999999950, 100));
+}
+
+void AdvancedViewsTest::testTreeAxisHide()
+{
+    TreeAxis axis;
+    axis.append({10, 20, 20, 30, 10});
+    QVERIFY(!axis.show(0, 1));
+    QVERIFY(!axis.hide(4, 2));
+
+    // Hidden elements keep their position and take no space
+    QVERIFY(axis.hide(1, 3));
+    QCOMPARE(axis.length(), 5);
+    QCOMPARE(axis.visualLength(), std::int64_t(20));
+    QVERIFY(axis.isHidden(2));
+    QVERIFY(!axis.isHidden(4));
+    QVERIFY(*axis.get(2) == AxisGetResult(2, 10, 0));
+    QVERIFY(*axis.visualGet(10) == AxisGetResult(4, 10, 10));
+    std::vector<Range> test = {Range(1, 10), Range(2, 20, 1), Range(1, 30, 1), Range(1, 10)};
+    QVERIFY(axis.ranges() == test);
+
+    // Hides nest like collapsed groups
+    QVERIFY(axis.hide(2, 1));
+    QVERIFY(axis.show(1, 3));
+    QCOMPARE(axis.visualLength(), std::int64_t(70));
+    QVERIFY(axis.isHidden(2));
+    QVERIFY(!axis.show(1, 2));
+    QVERIFY(axis.show(2, 1));
+    QCOMPARE(axis.visualLength(), std::int64_t(90));
+
+    // Elements hidden by a single operation over a long axis
+    TreeAxis large;
+    large.insertAt(0, Range(10000000, 20));
+    large.setVisualLength(5, 40);
+    QVERIFY(large.hide(1, 9999998));
+    QCOMPARE(large.visualLength(), std::int64_t(40));
+    QVERIFY(*large.visualGet(25) == AxisGetResult(9999999, 20, 20));
+    QVERIFY(large.setVisualLength(0, 10, 50));
+    QVERIFY(large.isHidden(5));
+    QCOMPARE(large.visualLength(), std::int64_t(70));
+    QVERIFY(large.show(1, 9999998));
+    QCOMPARE(large.visualLength(), std::int64_t(10 * 50 + 9999990 * 20));
+}
+
+void AdvancedViewsTest::testTreeAxisMatchesAxis()
+{
+    Axis axis;
+    TreeAxis treeAxis;
+    std::minstd_rand random(42);
+    for (int i = 0; i < 2000; ++i) {
+        const int length = axis.length();
+        const int pos = static_cast<int>(random() % (length + 1));
+        const int visualLength = 25 * static_cast<int>(1 + random() % 3);
+        const int count = static_cast<int>(random() % 4);
+        switch (random() % 11) {
+        case 0:
+        case 1:
+            QCOMPARE(treeAxis.insertAt(pos, visualLength), axis.insertAt(pos, visualLength));
+            break;
+        case 2:
+            QCOMPARE(treeAxis.removeAt(pos), axis.removeAt(pos));
+            break;
+        case 3: {
+            const int to = static_cast<int>(random() % (length + 1));
+            QCOMPARE(treeAxis.move(pos, to), axis.move(pos, to));
+            break;
+        }
+        case 4:
+            QCOMPARE(treeAxis.insertAt(pos, Range(count, visualLength)), axis.insertAt(pos, Range(count, visualLength)));
+            break;
+        case 5:
+            QCOMPARE(treeAxis.removeAt(pos, count), axis.removeAt(pos, count));
+            break;
+        case 6:
+            QCOMPARE(treeAxis.setVisualLength(pos, count, visualLength), axis.setVisualLength(pos, count, visualLength));
+            break;
+        case 7:
+            QCOMPARE(treeAxis.setVisualLength(pos, visualLength), axis.setVisualLength(pos, 1, visualLength));
+            break;
+        case 8: {
+            const int to = static_cast<int>(random() % (length + 1));
+            QCOMPARE(treeAxis.move(pos, count, to), axis.move(pos, count, to));
+            break;
+        }
+        case 9:
+            QCOMPARE(treeAxis.hide(pos, count * 4), axis.hide(pos, count * 4));
+            break;
+        case 10:
+            QCOMPARE(treeAxis.show(pos, count), axis.show(pos, count));
+            break;
+        }
+        QVERIFY(treeAxis.ranges() == axis.m_ranges);
+        QCOMPARE(treeAxis.isHidden(pos), axis.isHidden(pos));
+        QVERIFY(axis.m_offsets.size() == axis.m_ranges.size() + 1);
+        QCOMPARE(treeAxis.length(), axis.length());
+        QCOMPARE(treeAxis.visualLength(), axis.visualLength());
+        const int probe = static_cast<int>(random() % (axis.length() + 1));
+        QVERIFY(treeAxis.get(probe) == axis.get(probe));
+        const int visualProbe = static_cast<int>(random() % (axis.visualLength() + 1));
+        QVERIFY(treeAxis.visualGet(visualProbe) == axis.visualGet(visualProbe));
+    }
+    std::vector<AxisGetResult> results;
+    std::vector<AxisGetResult> treeResults;
+    axis.forEach(3, axis.length() - 3, [&results](const AxisGetResult &r) { results.push_back(r); });
+    treeAxis.forEach(3, axis.length() - 3, [&treeResults](const AxisGetResult &r) { treeResults.push_back(r); });
+    QCOMPARE(results.size(), std::size_t(std::max(0, axis.length() - 5)));
+    QVERIFY(results == treeResults);
+    for (int pos = 0; pos < axis.length(); ++pos)
+        QVERIFY(treeAxis.get(pos) == axis.get(pos));
+    for (int visualPos = 0; visualPos < axis.visualLength(); visualPos += 5)
+        QVERIFY(treeAxis.visualGet(visualPos) == axis.visualGet(visualPos));
+}
+
+void AdvancedViewsTest::testCellHash()
+{
+    CellHash hash;
+    QVERIFY(hash.empty());
+    QCOMPARE(hash.find(0, 0), -1);
+    QVERIFY(!hash.remove(0, 0));
+
+    hash.insert(0, 0, 10);
+    hash.insert(0, 1, 11);
+    hash.insert(1, 0, 12);
+    QCOMPARE(hash.size(), std::size_t(3));
+    QCOMPARE(hash.find(0, 0), 10);
+    QCOMPARE(hash.find(0, 1), 11);
+    QCOMPARE(hash.find(1, 0), 12);
+    QCOMPARE(hash.find(1, 1), -1);
+    QVERIFY(hash.contains(0, 1));
+
+    hash.insert(0, 1, 20);
+    QCOMPARE(hash.size(), std::size_t(3));
+    QCOMPARE(hash.find(0, 1), 20);
+
+    QVERIFY(hash.remove(0, 1));
+    QVERIFY(!hash.remove(0, 1));
+    QCOMPARE(hash.size(), std::size_t(2));
+    QCOMPARE(hash.find(0, 1), -1);
+    QCOMPARE(hash.find(1, 0), 12);
+
+    hash.insert(-1, 2000000000, 1);
+    QCOMPARE(hash.find(-1, 2000000000), 1);
+
+    hash.clear();
+    QVERIFY(hash.empty());
+    QCOMPARE(hash.find(0, 0), -1);
+}
+
+void AdvancedViewsTest::testCellHashMatchesMap()
+{
+    CellHash hash;
+    std::map<std::pair<int, int>, int> map;
+    std::minstd_rand random(42);
+    for (int i = 0; i < 20000; ++i) {
+        const int row = static_cast<int>(random() % 64);
+        const int column = static_cast<int>(random() % 64);
+        if (random() % 3 == 0) {
+            QCOMPARE(hash.remove(row, column), map.erase({row, column}) == 1);
+        } else {
+            hash.insert(row, column, i);
+            map[{row, column}] = i;
+        }
+        QCOMPARE(hash.size(), map.size());
+    }
+    for (int row = 0; row < 64; ++row) {
+        for (int column = 0; column < 64; ++column) {
+            const auto it = map.find({row, column});
+            QCOMPARE(hash.find(row, column), it == map.end() ? -1 : it->second);
+        }
+    }
+}
+
+void AdvancedViewsTest::testPermutation()
+{
+    Permutation permutation;
+    permutation.reset(5);
+    QVERIFY(permutation.isIdentity());
+    QCOMPARE(permutation.toVisual(3), 3);
+    QCOMPARE(permutation.toLogical(5), -1);
+
+    // An order that is not a permutation is refused
+    QVERIFY(!permutation.setOrder({0, 1, 1}));
+    QCOMPARE(permutation.length(), 5);
+
+    QVERIFY(permutation.setOrder({3, 0, 4, 1, 2}));
+    QVERIFY(!permutation.isIdentity());
+    QCOMPARE(permutation.toLogical(0), 3);
+    QCOMPARE(permutation.toVisual(3), 0);
+    QCOMPARE(permutation.toVisual(2), 4);
+    QVERIFY(permutation.order() == std::vector<int>({3, 0, 4, 1, 2}));
+
+    // Logical moves keep the visual order of the elements
+    QVERIFY(permutation.moveLogical(0, 1, 5));
+    QVERIFY(permutation.order() == std::vector<int>({2, 4, 3, 0, 1}));
+    QVERIFY(permutation.moveVisual(3, 2, 0));
+    QVERIFY(permutation.order() == std::vector<int>({0, 1, 2, 4, 3}));
+
+    QVERIFY(permutation.insert(1, 2, 5));
+    QVERIFY(permutation.order() == std::vector<int>({0, 3, 4, 6, 5, 1, 2}));
+    QVERIFY(permutation.remove(3, 2));
+    QVERIFY(permutation.order() == std::vector<int>({0, 4, 3, 1, 2}));
+    QVERIFY(!permutation.remove(4, 2));
+
+    // The identity is kept without breaking it
+    permutation.reset(3);
+    QVERIFY(permutation.insert(1, 2, 1));
+    QVERIFY(permutation.remove(0, 1));
+    QVERIFY(permutation.isIdentity());
+    QCOMPARE(permutation.length(), 4);
+    QVERIFY(permutation.insert(0, 1, 4));
+    QVERIFY(permutation.order() == std::vector<int>({1, 2, 3, 4, 0}));
+}
+
+void AdvancedViewsTest::testPermutationMatchesVector()
+{
+    Permutation permutation;
+    permutation.reset(100);
+    std::vector<int> order(100);
+    std::iota(order.begin(), order.end(), 0);
+    std::minstd_rand random(42);
+    for (int i = 0; i < 2000; ++i) {
+        const int length = static_cast<int>(order.size());
+        switch (random() % 6) {
+        case 0: {
+            const int logical = static_cast<int>(random() % (length + 1));
+            const int visual = static_cast<int>(random() % (length + 1));
+            const int count = static_cast<int>(random() % 4);
+            for (int &value : order)
+                value += value >= logical ? count : 0;
+            for (int j = 0; j < count; ++j)
+                order.insert(order.begin() + visual + j, logical + j);
+            QVERIFY(permutation.insert(logical, count, visual));
+            break;
+        }
+        case 1: {
+            const int logical = static_cast<int>(random() % (length + 1));
+            const int count = std::min(static_cast<int>(random() % 4), length - logical);
+            order.erase(std::remove_if(order.begin(), order.end(), [=](int value) {
+                return value >= logical && value < logical + count;
+            }), order.end());
+            for (int &value : order)
+                value -= value >= logical + count ? count : 0;
+            QVERIFY(permutation.remove(logical, count));
+            break;
+        }
+        case 2:
+        case 3: {
+            const int from = static_cast<int>(random() % (length + 1));
+            const int count = std::min(static_cast<int>(random() % 4), length - from);
+            const int to = static_cast<int>(random() % (length + 1));
+            const bool logical = random() % 2 == 0;
+            if (logical) {
+                // Move the logical values as the elements of a vector
+                std::vector<int> moved(length);
+                std::iota(moved.begin(), moved.end(), 0);
+                if (!(to >= from && to <= from + count)) {
+                    const int newFirst = to > from ? to - count : to;
+                    std::vector<int> block(moved.begin() + from, moved.begin() + from + count);
+                    moved.erase(moved.begin() + from, moved.begin() + from + count);
+                    moved.insert(moved.begin() + newFirst, block.begin(), block.end());
+                }
+                std::vector<int> newLogical(length);
+                for (int j = 0; j < length; ++j)
+                    newLogical[moved[j]] = j;
+                for (int &value : order)
+                    value = newLogical[value];
+                QVERIFY(permutation.moveLogical(from, count, to));
+            } else {
+                if (!(to >= from && to <= from + count)) {
+                    const int newFirst = to > from ? to - count : to;
+                    std::vector<int> block(order.begin() + from, order.begin() + from + count);
+                    order.erase(order.begin() + from, order.begin() + from + count);
+                    order.insert(order.begin() + newFirst, block.begin(), block.end());
+                }
+                QVERIFY(permutation.moveVisual(from, count, to));
+            }
+            break;
+        }
+        case 4:
+            if (random() % 50 == 0) {
+                std::shuffle(order.begin(), order.end(), random);
+                QVERIFY(permutation.setOrder(order));
+            }
+            break;
+        default:
+            break;
+        }
+        QCOMPARE(permutation.length(), static_cast<int>(order.size()));
+    }
+
+    QVERIFY(permutation.order() == order);
+    for (int visual = 0; visual < static_cast<int>(order.size()); ++visual) {
+        QCOMPARE(permutation.toLogical(visual), order[visual]);
+        QCOMPARE(permutation.toVisual(order[visual]), visual);
+    }
+}
+
+void AdvancedViewsTest::testTreeRows()
+{
+    // a(b(c), d), e(f)
+    auto node = [](int modelRow, int depth) {
+        TreeRows::Node result;
+        result.modelRow = modelRow;
+        result.depth = depth;
+        return result;
+    };
+    TreeRows rows;
+    QCOMPARE(rows.insert(-1, 0, {node(0, 0), node(0, 1), node(0, 2), node(1, 1), node(1, 0), node(0, 1)}), 0);
+    QCOMPARE(rows.size(), 6);
+    QCOMPARE(rows.node(0).descendants, 3);
+    QCOMPARE(rows.node(1).descendants, 1);
+    QCOMPARE(rows.node(4).descendants, 1);
+    QCOMPARE(rows.node(3).parent, 0);
+    QCOMPARE(rows.node(5).parent, 4);
+    QCOMPARE(rows.node(2).depth, 2);
+    QCOMPARE(rows.childRow(-1, 1), 4);
+    QCOMPARE(rows.childRow(0, 1), 3);
+    QCOMPARE(rows.childRow(0, 2), -1);
+    QCOMPARE(rows.find({0, 0, 0}), 2);
+    QCOMPARE(rows.find({1, 1}), -1);
+    QVERIFY(rows.path(3) == std::vector<int>({0, 1}));
+
+    // Insert g(h) between b and d
+    QCOMPARE(rows.insert(0, 1, {node(1, 0), node(0, 1)}), 3);
+    QCOMPARE(rows.node(0).descendants, 5);
+    QCOMPARE(rows.node(5).modelRow, 2);
+    QCOMPARE(rows.node(4).parent, 3);
+    QCOMPARE(rows.node(7).parent, 6);
+    QCOMPARE(rows.find({0, 2}), 5);
+
+    // Remove b(c) and g(h)
+    rows.remove(1, 4);
+    QCOMPARE(rows.size(), 4);
+    QCOMPARE(rows.node(0).descendants, 1);
+    QCOMPARE(rows.node(1).modelRow, 0);
+    QCOMPARE(rows.node(3).parent, 2);
+
+    // The hide count of a row is the number of its collapsed ancestors,
+    // so collapsed subtrees stay hidden when their parent is expanded
+    rows.clear();
+    rows.insert(-1, 0, {node(0, 0), node(0, 1), node(0, 2), node(1, 1), node(1, 0)});
+    TreeAxis axis;
+    for (int row = 0; row < rows.size(); ++row)
+        axis.insertAt(row, Range(1, 10, rows.node(row).depth));
+    QCOMPARE(axis.visualLength(), 20);
+    rows.setExpanded(0, true);
+    QVERIFY(axis.show(1, rows.node(0).descendants));
+    QCOMPARE(axis.visualLength(), 40);
+    QVERIFY(axis.isHidden(2));
+    QCOMPARE(rows.collapsedCount(1), 1);
+    rows.setExpanded(1, true);
+    QVERIFY(axis.show(2, rows.node(1).descendants));
+    QCOMPARE(axis.visualLength(), 50);
+    rows.setExpanded(0, false);
+    QVERIFY(axis.hide(1, rows.node(0).descendants));
+    QCOMPARE(axis.visualLength(), 20);
+    rows.setExpanded(0, true);
+    QVERIFY(axis.show(1, rows.node(0).descendants));
+    QCOMPARE(axis.visualLength(), 50);
+}
+
+void AdvancedViewsTest::testTreeRowsMatchesTree()
+{
+    struct Item
+    {
+        std::vector<Item> children;
+    };
+    struct Flat
+    {
+        int parent;
+        int modelRow;
+        int depth;
+        int descendants;
+    };
+    std::function<int(const Item&, int, int, int, std::vector<Flat>&)> flatten;
+    flatten = [&](const Item &item, int parent, int modelRow, int depth, std::vector<Flat> &result) {
+        const int row = static_cast<int>(result.size());
+        result.push_back({parent, modelRow, depth, 0});
+        for (std::size_t i = 0; i < item.children.size(); ++i)
+            flatten(item.children[i], row, static_cast<int>(i), depth + 1, result);
+        result[row].descendants = static_cast<int>(result.size()) - row - 1;
+        return row;
+    };
+    // The root is the first flat row and is left out of the comparisons
+    auto flat = [&](const Item &root) {
+        std::vector<Flat> result;
+        flatten(root, -2, 0, -1, result);
+        return result;
+    };
+    std::function<Item*(Item&, const std::vector<Flat>&, int)> itemAt;
+    itemAt = [&](Item &root, const std::vector<Flat> &rows, int row) -> Item* {
+        if (row == 0)
+            return &root;
+        return &itemAt(root, rows, rows[row].parent)->children[rows[row].modelRow];
+    };
+
+    Item root;
+    TreeRows rows;
+    std::minstd_rand random(42);
+    for (int i = 0; i < 1000; ++i) {
+        const std::vector<Flat> before = flat(root);
+        const int parent = static_cast<int>(random() % before.size());
+        Item *item = itemAt(root, before, parent);
+        const int childCount = static_cast<int>(item->children.size());
+        if (random() % 3 != 0 || childCount == 0) {
+            // Insert up to three subtrees of up to three rows
+            const int modelRow = static_cast<int>(random() % (childCount + 1));
+            std::vector<Item> inserted(1 + random() % 3);
+            std::vector<TreeRows::Node> nodes;
+            for (std::size_t j = 0; j < inserted.size(); ++j) {
+                TreeRows::Node node;
+                node.modelRow = modelRow + static_cast<int>(j);
+                nodes.push_back(node);
+                for (int k = static_cast<int>(random() % 3); k > 0; --k) {
+                    node.modelRow = static_cast<int>(inserted[j].children.size());
+                    node.depth = 1;
+                    nodes.push_back(node);
+                    inserted[j].children.emplace_back();
+                }
+            }
+            item->children.insert(item->children.begin() + modelRow, inserted.begin(), inserted.end());
+            rows.insert(parent - 1, modelRow, nodes);
+        } else {
+            const int modelRow = static_cast<int>(random() % childCount);
+            const int count = std::min(static_cast<int>(1 + random() % 2), childCount - modelRow);
+            const int first = rows.childRow(parent - 1, modelRow);
+            const int last = rows.childRow(parent - 1, modelRow + count - 1);
+            QVERIFY(first != -1 && last != -1);
+            rows.remove(first, rows.subtreeEnd(last) - first);
+            item->children.erase(item->children.begin() + modelRow, item->children.begin() + modelRow + count);
+        }
+
+        const std::vector<Flat> after = flat(root);
+        QCOMPARE(rows.size(), static_cast<int>(after.size()) - 1);
+        for (int row = 0; row < rows.size(); ++row) {
+            const Flat &expected = after[row + 1];
+            QCOMPARE(rows.node(row).parent, expected.parent - 1);
+            QCOMPARE(rows.node(row).modelRow, expected.modelRow);
+            QCOMPARE(rows.node(row).depth, expected.depth);
+            QCOMPARE(rows.node(row).descendants, expected.descendants);
+            QCOMPARE(rows.find(rows.path(row)), row);
+        }
+    }
+}
+
+void AdvancedViewsTest::testSpanIndex()
+{
+    SpanIndex index;
+    QVERIFY(index.empty());
+    QVERIFY(!index.find(0, 0));
+
+    index.insert(QRect(1, 1, 2, 3));
+    index.insert(QRect(5, 0, 1, 2));
+    QCOMPARE(index.size(), std::size_t(2));
+    QCOMPARE(*index.find(3, 2), QRect(1, 1, 2, 3));
+    QCOMPARE(*index.find(1, 5), QRect(5, 0, 1, 2));
+    QVERIFY(!index.find(0, 1));
+    QVERIFY(!index.find(4, 1));
+
+    // Each span is visited once however many rows of the query it crosses
+    std::vector<QRect> spans;
+    index.forEachIntersecting(QRect(0, 0, 10, 10), [&spans](QRect span) { spans.push_back(span); });
+    std::vector<QRect> test = {QRect(5, 0, 1, 2), QRect(1, 1, 2, 3)};
+    QVERIFY(spans == test);
+
+    // Inserting an overlapping span replaces the spans it intersects
+    index.insert(QRect(2, 0, 4, 2));
+    QCOMPARE(index.size(), std::size_t(1));
+    QCOMPARE(*index.find(0, 3), QRect(2, 0, 4, 2));
+
+    QVERIFY(!index.remove(QPoint(3, 0)));
+    QVERIFY(index.remove(QPoint(2, 0)));
+    QVERIFY(index.empty());
+}
+
+void AdvancedViewsTest::testSpanIndexMatchesBruteForce()
+{
+    SpanIndex index;
+    std::vector<QRect> spans;
+    std::minstd_rand random(42);
+    for (int i = 0; i < 2000; ++i) {
+        const QRect span(static_cast<int>(random() % 200), static_cast<int>(random() % 200),
+                         1 + static_cast<int>(random() % 4), 1 + static_cast<int>(random() % 8));
+        if (random() % 4 == 0 && !spans.empty()) {
+            const std::size_t victim = random() % spans.size();
+            QVERIFY(index.remove(spans[victim].topLeft()));
+            spans.erase(spans.begin() + victim);
+        } else {
+            index.insert(span);
+            spans.erase(std::remove_if(spans.begin(), spans.end(), [span](QRect other) { return other.intersects(span); }), spans.end());
+            spans.push_back(span);
+        }
+        QCOMPARE(index.size(), spans.size());
+    }
+
+    auto less = [](QRect a, QRect b) { return std::make_pair(a.top(), a.left()) < std::make_pair(b.top(), b.left()); };
+    std::sort(spans.begin(), spans.end(), less);
+    for (int i = 0; i < 100; ++i) {
+        const QRect query(static_cast<int>(random() % 200), static_cast<int>(random() % 200),
+                          1 + static_cast<int>(random() % 50), 1 + static_cast<int>(random() % 50));
+        std::vector<QRect> result;
+        index.forEachIntersecting(query, [&result](QRect span) { result.push_back(span); });
+        std::vector<QRect> test;
+        std::copy_if(spans.begin(), spans.end(), std::back_inserter(test), [query](QRect span) { return span.intersects(query); });
+        QVERIFY(result == test);
+    }
+}
+
+void AdvancedViewsTest::testOverscanSplit()
+{
+    QCOMPARE(overscan::split(0, 1000), std::make_pair(0, 0));
+    QCOMPARE(overscan::split(-10, 0), std::make_pair(0, 0));
+    QCOMPARE(overscan::split(200, 0), std::make_pair(100, 100));
+    QCOMPARE(overscan::split(200, 400), std::make_pair(100, 100));
+    QCOMPARE(overscan::split(200, 600), std::make_pair(50, 150));
+    QCOMPARE(overscan::split(200, -600), std::make_pair(150, 50));
+    QCOMPARE(overscan::split(200, 5000), std::make_pair(0, 200));
+    QCOMPARE(overscan::split(200, -5000), std::make_pair(200, 0));
+}
+
+void AdvancedViewsTest::testOverscanArea()
+{
+    const QRect visibleArea(1000, 1000, 400, 300);
+    QCOMPARE(overscan::area(visibleArea, 0, 0, QPointF(1000, 1000)), visibleArea);
+    QCOMPARE(overscan::area(visibleArea, 200, 100, QPointF(0, 0)), QRect(900, 950, 600, 400));
+    QCOMPARE(overscan::area(visibleArea, 200, 100, QPointF(5000, -5000)), QRect(1000, 900, 600, 400));
+    QVERIFY(!overscan::area(QRect(), 200, 100, QPointF(0, 0)).isValid());
+}
+
 void AdvancedViewsTest::testTableBoundingRect()
 {
     Table table;
@@ -329,6 +1357,284 @@ void AdvancedViewsTest::testTableCellsInRect()
     QVERIFY(std::equal(cells.begin(), cells.end(), test.begin()));
 }
 
+void AdvancedViewsTest::testTableCellsInRectBuffer()
+{
+    Table table;
+    table.m_xAxis.append({100, 50, 100});
+    table.m_yAxis.append({50, 50, 25, 50});
+
+    std::vector<Cell> cells;
+    table.cellsInVisualRect(QRect(120, 60, 100, 50), cells);
+    std::vector<Cell> test = {Cell(1, 1, QRect(100, 50, 50, 50)), Cell(1, 2, QRect(150, 50, 100, 50)),
+                              Cell(2, 1, QRect(100, 100, 50, 25)), Cell(2, 2, QRect(150, 100, 100, 25))};
+    QVERIFY(cells == test);
+
+    // The buffer is cleared and its storage reused
+    const Cell *data = cells.data();
+    table.cellsInVisualRect(QRect(0, 0, 10, 10), cells);
+    test = {Cell(0, 0, QRect(0, 0, 100, 50))};
+    QVERIFY(cells == test);
+    QVERIFY(cells.data() == data);
+
+    table.cellsInVisualRect(QRect(1000, 1000, 10, 10), cells);
+    QVERIFY(cells.empty());
+
+    // Cells are emitted in row major order
+    table.cellsInVisualRect(table.boundingRect(), cells);
+    QCOMPARE(cells.size(), std::size_t(12));
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        QCOMPARE(cells[i].row(), int(i / 3));
+        QCOMPARE(cells[i].column(), int(i % 3));
+    }
+}
+
+void AdvancedViewsTest::testTableIndexesInRect()
+{
+    Table table;
+    QVERIFY(!table.indexesInVisualRect(QRect(0, 0, 100, 100)).isValid());
+
+    table.m_xAxis.append({100, 50, 100});
+    table.m_yAxis.append({50, 50, 25, 50});
+    QCOMPARE(table.indexesInVisualRect(QRect(0, 0, 250, 175)), QRect(0, 0, 3, 4));
+    QCOMPARE(table.indexesInVisualRect(QRect(120, 60, 100, 50)), QRect(1, 1, 2, 2));
+    QCOMPARE(table.indexesInVisualRect(QRect(-50, 120, 60, 500)), QRect(0, 2, 1, 2));
+    QVERIFY(!table.indexesInVisualRect(QRect(250, 0, 10, 10)).isValid());
+}
+
+void AdvancedViewsTest::testTableCellsInIndexRect()
+{
+    Table table;
+    table.m_xAxis.append({100, 50, 100});
+    table.m_yAxis.append({50, 50, 25, 50});
+
+    std::vector<Cell> cells;
+    table.cellsInIndexRect(QRect(2, 1, 1, 3), cells);
+    std::vector<Cell> test = {Cell(1, 2, QRect(150, 50, 100, 50)),
+                              Cell(2, 2, QRect(150, 100, 100, 25)),
+                              Cell(3, 2, QRect(150, 125, 100, 50))};
+    QVERIFY(cells == test);
+
+    table.cellsInIndexRect(QRect(), cells);
+    QVERIFY(cells.empty());
+}
+
+void AdvancedViewsTest::testTableCellAt()
+{
+    Table table;
+    QVERIFY(!table.cellAt(0, 0));
+
+    table.m_xAxis.append({100, 50, 100});
+    table.m_yAxis.append({50, 50, 25, 50});
+    QCOMPARE(*table.cellAt(0, 0), Cell(0, 0, QRect(0, 0, 100, 50)));
+    QCOMPARE(*table.cellAt(2, 1), Cell(2, 1, QRect(100, 100, 50, 25)));
+    QVERIFY(!table.cellAt(4, 0));
+    QVERIFY(!table.cellAt(0, 3));
+    QVERIFY(!table.cellAt(-1, 0));
+
+    // Cells follow the structural changes of the axes
+    table.m_yAxis.insertAt(1, Range(2, 10));
+    QCOMPARE(*table.cellAt(3, 1), Cell(3, 1, QRect(100, 70, 50, 50)));
+    table.m_yAxis.move(0, 1, 3);
+    QCOMPARE(*table.cellAt(2, 0), Cell(2, 0, QRect(0, 20, 100, 50)));
+}
+
+void AdvancedViewsTest::testTableOrigin()
+{
+    Table table;
+    table.m_xAxis.insertAt(0, Range(10, 100));
+    table.m_yAxis.insertAt(0, Range(100000000, 50));
+
+    // Rects are relative to the origin
+    table.setOrigin(0, 4000000000);
+    QCOMPARE(table.boundingRect(), QRect(0, std::numeric_limits<int>::min(), 1000, std::numeric_limits<int>::max()));
+    QCOMPARE(table.indexesInVisualRect(QRect(150, 10, 100, 100)), QRect(1, 80000000, 2, 3));
+    QCOMPARE(*table.cellAt(80000001, 1), Cell(80000001, 1, QRect(100, 50, 100, 50)));
+
+    std::vector<Cell> cells;
+    table.cellsInVisualRect(QRect(0, -20, 50, 40), cells);
+    std::vector<Cell> test = {Cell(79999999, 0, QRect(0, -50, 100, 50)), Cell(80000000, 0, QRect(0, 0, 100, 50))};
+    QVERIFY(cells == test);
+
+    // The end of the table is reached relatively to the origin
+    QCOMPARE(table.indexesInVisualRect(QRect(0, 999999950, 100, 1000)), QRect(0, 99999999, 1, 1));
+    QVERIFY(!table.indexesInVisualRect(QRect(0, 1000000000, 100, 100)).isValid());
+}
+
+void AdvancedViewsTest::testTableSpans()
+{
+    Table table;
+    table.m_xAxis.append({100, 50, 100, 100});
+    table.m_yAxis.append({50, 50, 25, 50});
+    QVERIFY(!table.setSpan(-1, 0, 2, 2));
+    QVERIFY(!table.setSpan(0, 0, 0, 2));
+    QVERIFY(table.setSpan(0, 1, 3, 2));
+    QVERIFY(table.setSpan(3, 3, 2, 2));
+    QCOMPARE(*table.spanAt(2, 2), QRect(1, 0, 2, 3));
+    QVERIFY(!table.spanAt(0, 0));
+
+    // Spans are merged into one cell and clipped to the table
+    std::vector<Cell> cells;
+    table.spansInVisualRect(QRect(120, 90, 500, 100), cells);
+    std::vector<Cell> test = {Cell(0, 1, QRect(100, 0, 150, 125)), Cell(3, 3, QRect(250, 125, 100, 50))};
+    QVERIFY(cells == test);
+    table.spansInVisualRect(QRect(0, 0, 100, 100), cells);
+    QVERIFY(cells.empty());
+
+    // Merged rects are relative to the origin
+    table.setOrigin(100, 50);
+    QCOMPARE(*table.spanCell(QRect(1, 0, 2, 3)), Cell(0, 1, QRect(0, -50, 150, 125)));
+
+    // A single cell span unmerges the span holding it
+    QVERIFY(table.setSpan(1, 2, 1, 1));
+    QVERIFY(!table.spanAt(0, 1));
+    QCOMPARE(table.spans().size(), std::size_t(1));
+    table.clearSpans();
+    QVERIFY(table.spans().empty());
+}
+
+void AdvancedViewsTest::testTableSpansInsert()
+{
+    auto spans = [](const Table &table) {
+        std::vector<QRect> result;
+        table.spans().forEach([&result](QRect span) { result.push_back(span); });
+        return result;
+    };
+    Table table;
+    table.m_xAxis.insertAt(0, Range(10, 100));
+    table.m_yAxis.insertAt(0, Range(10, 50));
+    QVERIFY(table.setSpan(2, 1, 3, 2));
+    QVERIFY(table.setSpan(6, 4, 2, 1));
+
+    // Rows inserted after a span leave it alone, the ones before move it
+    // and the ones inside grow it
+    table.m_yAxis.insertAt(8, Range(1, 50));
+    table.insertSpanElements(Qt::Vertical, 8, 1);
+    std::vector<QRect> test = {QRect(1, 2, 2, 3), QRect(4, 6, 1, 2)};
+    QVERIFY(spans(table) == test);
+    table.m_yAxis.insertAt(5, Range(2, 50));
+    table.insertSpanElements(Qt::Vertical, 5, 2);
+    test = {QRect(1, 2, 2, 3), QRect(4, 8, 1, 2)};
+    QVERIFY(spans(table) == test);
+    table.m_yAxis.insertAt(3, Range(1, 50));
+    table.insertSpanElements(Qt::Vertical, 3, 1);
+    test = {QRect(1, 2, 2, 4), QRect(4, 9, 1, 2)};
+    QVERIFY(spans(table) == test);
+    QCOMPARE(*table.spanAt(3, 2), QRect(1, 2, 2, 4));
+    QVERIFY(!table.spanAt(6, 1));
+
+    // Columns inserted at the first column of a span move it
+    table.m_xAxis.insertAt(1, Range(1, 100));
+    table.insertSpanElements(Qt::Horizontal, 1, 1);
+    test = {QRect(2, 2, 2, 4), QRect(5, 9, 1, 2)};
+    QVERIFY(spans(table) == test);
+    QCOMPARE(*table.spanCell(QRect(2, 2, 2, 4)), Cell(2, 2, QRect(200, 100, 200, 200)));
+}
+
+void AdvancedViewsTest::testTableSpansRemove()
+{
+    auto spans = [](const Table &table) {
+        std::vector<QRect> result;
+        table.spans().forEach([&result](QRect span) { result.push_back(span); });
+        return result;
+    };
+    // Remove count rows from pos as the view does with its map of indexes
+    auto removeRows = [](Table &table, int pos, int count) {
+        table.m_yAxis.removeAt(pos, count);
+        table.mapSpanElements(Qt::Vertical, [pos, count](int row) {
+            if (row < pos)
+                return row;
+            return row < pos + count ? -1 : row - count;
+        });
+    };
+    Table table;
+    table.m_xAxis.insertAt(0, Range(10, 100));
+    table.m_yAxis.insertAt(0, Range(20, 50));
+    QVERIFY(table.setSpan(2, 1, 4, 2));
+    QVERIFY(table.setSpan(10, 0, 3, 1));
+
+    // Rows removed after a span leave it alone and the ones before move it
+    removeRows(table, 15, 2);
+    std::vector<QRect> test = {QRect(1, 2, 2, 4), QRect(0, 10, 1, 3)};
+    QVERIFY(spans(table) == test);
+    removeRows(table, 7, 2);
+    test = {QRect(1, 2, 2, 4), QRect(0, 8, 1, 3)};
+    QVERIFY(spans(table) == test);
+
+    // Rows removed inside a span or across one of its edges shrink it
+    removeRows(table, 3, 1);
+    test = {QRect(1, 2, 2, 3), QRect(0, 7, 1, 3)};
+    QVERIFY(spans(table) == test);
+    removeRows(table, 6, 2);
+    test = {QRect(1, 2, 2, 3), QRect(0, 6, 1, 2)};
+    QVERIFY(spans(table) == test);
+
+    // A span left with a single cell or without cells is dropped
+    removeRows(table, 6, 1);
+    test = {QRect(1, 2, 2, 3)};
+    QVERIFY(spans(table) == test);
+    table.m_xAxis.removeAt(2, 1);
+    table.mapSpanElements(Qt::Horizontal, [](int column) { return column == 2 ? -1 : column > 2 ? column - 1 : column; });
+    test = {QRect(1, 2, 1, 3)};
+    QVERIFY(spans(table) == test);
+    removeRows(table, 1, 5);
+    QVERIFY(table.spans().empty());
+}
+
+void AdvancedViewsTest::testTableSpansMove()
+{
+    auto spans = [](const Table &table) {
+        std::vector<QRect> result;
+        table.spans().forEach([&result](QRect span) { result.push_back(span); });
+        return result;
+    };
+    Table table;
+    table.m_xAxis.insertAt(0, Range(10, 100));
+    table.m_yAxis.insertAt(0, Range(10, 50));
+    QVERIFY(table.setSpan(1, 0, 2, 2));
+    QVERIFY(table.setSpan(5, 0, 3, 1));
+
+    // Spans moved as a whole or moved around keep their cells, and a
+    // span whose rows are moved apart is dropped
+    std::vector<int> order = {0, 3, 4, 1, 2, 5, 6, 7, 8, 9};
+    table.mapSpanElements(Qt::Vertical, [&order](int row) {
+        return static_cast<int>(std::distance(order.begin(), std::find(order.begin(), order.end(), row)));
+    });
+    std::vector<QRect> test = {QRect(0, 3, 2, 2), QRect(0, 5, 1, 3)};
+    QVERIFY(spans(table) == test);
+
+    order = {0, 1, 2, 3, 4, 5, 7, 6, 8, 9};
+    table.mapSpanElements(Qt::Vertical, [&order](int row) {
+        return static_cast<int>(std::distance(order.begin(), std::find(order.begin(), order.end(), row)));
+    });
+    test = {QRect(0, 3, 2, 2), QRect(0, 5, 1, 3)};
+    QVERIFY(spans(table) == test);
+
+    order = {0, 1, 2, 3, 5, 6, 7, 8, 9, 4};
+    table.mapSpanElements(Qt::Vertical, [&order](int row) {
+        return static_cast<int>(std::distance(order.begin(), std::find(order.begin(), order.end(), row)));
+    });
+    test = {QRect(0, 4, 1, 3)};
+    QVERIFY(spans(table) == test);
+}
+
+void AdvancedViewsTest::testTableHidden()
+{
+    Table table;
+    table.m_xAxis.append({100, 50, 100});
+    table.m_yAxis.insertAt(0, Range(1000000, 20));
+    table.m_yAxis.hide(1, 999998);
+    table.m_xAxis.hide(1, 1);
+
+    // Hidden rows and columns are skipped however many they are
+    QCOMPARE(table.indexesInVisualRect(QRect(0, 0, 200, 40)), QRect(0, 0, 3, 1000000));
+    std::vector<Cell> cells;
+    table.cellsInVisualRect(QRect(0, 0, 200, 40), cells);
+    std::vector<Cell> test = {Cell(0, 0, QRect(0, 0, 100, 20)), Cell(0, 2, QRect(100, 0, 100, 20)),
+                              Cell(999999, 0, QRect(0, 20, 100, 20)), Cell(999999, 2, QRect(100, 20, 100, 20))};
+    QVERIFY(cells == test);
+    QCOMPARE(*table.cellAt(5, 1), Cell(5, 1, QRect(100, 20, 0, 0)));
+}
+
 QTEST_APPLESS_MAIN(AdvancedViewsTest)
 
 #include "tst_advancedviews.moc"
@@ -0,0 +1,984 @@
+/*
+    This file is part of AdvancedViews.
+
+    AdvancedViews is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    AdvancedViews is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with AdvancedViews.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQmlIncubator>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QSortFilterProxyModel>
+#include <QStandardItemModel>
+#include <QStringListModel>
+#include <QtMath>
+
+#include <advancedviews_plugin.h>
+#include <tableviewprivate.h>
+
+#include <memory>
+
+namespace
+{
+
+// A window showing the item created from qml. Unless a controller is
+// given, the engine has none and delegates are incubated by the views
+// within their budget
+class ViewFixture
+{
+public:
+    ViewFixture(const QByteArray &qml, QObject *model = nullptr, QQmlIncubationController *controller = nullptr)
+    {
+        if (controller)
+            m_engine.setIncubationController(controller);
+        m_engine.rootContext()->setContextProperty(QStringLiteral("testModel"), model);
+        QQmlComponent component(&m_engine);
+        component.setData(qml, QUrl());
+        m_root.reset(qobject_cast<QQuickItem*>(component.create()));
+        if (!m_root) {
+            qWarning() << component.errors();
+            return;
+        }
+        m_root->setParentItem(m_window.contentItem());
+        m_window.resize(qCeil(m_root->width()), qCeil(m_root->height()));
+        m_window.show();
+    }
+
+    QQuickWindow *window() { return &m_window; }
+    QQuickItem *root() const { return m_root.get(); }
+    TableViewPrivate *view() const { return m_root ? m_root->findChild<TableViewPrivate*>() : nullptr; }
+
+    // Return the number of delegate items shown by the view
+    int itemCount() const
+    {
+        int result = 0;
+        for (const QQuickItem *item : view()->childItems())
+            result += item->isVisible() ? 1 : 0;
+        return result;
+    }
+
+    // Return the number of hidden items, which are pooled unless incubating
+    int hiddenItemCount() const
+    {
+        return view()->childItems().size() - itemCount();
+    }
+
+private:
+    QQmlEngine m_engine;
+    QQuickWindow m_window;
+    std::unique_ptr<QQuickItem> m_root;
+};
+
+QStandardItemModel *createModel(int rows, int columns, QObject *parent)
+{
+    auto model = new QStandardItemModel(rows, columns, parent);
+    for (int row = 0; row < rows; ++row)
+        for (int column = 0; column < columns; ++column)
+            model->setItem(row, column, new QStandardItem(QStringLiteral("%1,%2").arg(row).arg(column)));
+    return model;
+}
+
+QString itemText(QQuickItem *item)
+{
+    return item ? item->property("text").toString() : QString();
+}
+
+}
+
+class TableViewTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    static void initMain();
+
+private slots:
+    void initTestCase();
+
+    void testModelDelegates();
+    void testDataChanged();
+    void testRecycledContext();
+    void testIncubationBudget();
+    void testEngineIncubationController();
+    void testOverscanPriority();
+    void testPoolTrim();
+    void testDelegateChooser();
+    void testDestroyedDelegate();
+    void testLightweightCells();
+    void testLayoutChange();
+    void testModelResetSameCount();
+    void testAutoRowHeight();
+    void testDefaultRowHeight();
+    void testDeepScrolling();
+    void testMeasurementAnchoring();
+    void testFrozenCells();
+    void testSpansFollowModel();
+    void testListView();
+};
+
+void TableViewTest::initMain()
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    qputenv("QT_QUICK_BACKEND", "software");
+}
+
+void TableViewTest::initTestCase()
+{
+    AdvancedViewsPlugin().registerTypes("AdvancedViews");
+}
+
+void TableViewTest::testModelDelegates()
+{
+    QStandardItemModel *model = createModel(100, 10, this);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 250
+            height: 250
+            model: testModel
+            cellDelegate: Item {
+                property string text: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QCOMPARE(view->rowCount(), 100);
+    QCOMPARE(view->columnCount(), 10);
+
+    // Only the cells crossing the visible area have an item
+    QTRY_VERIFY(view->itemAt(2, 2));
+    QTRY_COMPARE(fixture.itemCount(), 9);
+    QVERIFY(!view->itemAt(3, 0));
+    QVERIFY(!view->itemAt(0, 3));
+    QCOMPARE(view->itemAt(1, 2)->position(), QPointF(200, 100));
+    QCOMPARE(view->itemAt(1, 2)->size(), QSizeF(100, 100));
+    QCOMPARE(itemText(view->itemAt(1, 2)), QStringLiteral("1,2"));
+
+    // Inserted rows push the items down
+    model->insertRow(0, QList<QStandardItem*>() << new QStandardItem(QStringLiteral("new")));
+    QCOMPARE(view->rowCount(), 101);
+    QTRY_COMPARE(itemText(view->itemAt(0, 0)), QStringLiteral("new"));
+    QCOMPARE(itemText(view->itemAt(1, 0)), QStringLiteral("0,0"));
+    QCOMPARE(view->itemAt(1, 0)->position(), QPointF(0, 100));
+
+    model->removeRows(0, 2);
+    QCOMPARE(view->rowCount(), 99);
+    QTRY_COMPARE(itemText(view->itemAt(0, 0)), QStringLiteral("1,0"));
+    QCOMPARE(view->itemAt(0, 0)->position(), QPointF(0, 0));
+
+    // Changed data reaches the items of the live cells
+    model->item(0, 1)->setText(QStringLiteral("changed"));
+    QTRY_COMPARE(itemText(view->itemAt(0, 1)), QStringLiteral("changed"));
+    QTRY_COMPARE(fixture.itemCount(), 9);
+}
+
+void TableViewTest::testDataChanged()
+{
+    QStandardItemModel *model = createModel(100, 10, this);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 250
+            height: 250
+            model: testModel
+            cellDelegate: Item {
+                property string text: model.display
+                property int updates: 0
+                onTextChanged: updates++
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QTRY_COMPARE(fixture.itemCount(), 9);
+    auto updates = [&](int row, int column) {
+        return view->itemAt(row, column)->property("updates").toInt();
+    };
+    std::vector<int> before;
+    for (int row = 0; row < 3; ++row)
+        for (int column = 0; column < 3; ++column)
+            before.push_back(updates(row, column));
+
+    // Changes of cells that are not shown touch no item, and the changes of a
+    // cell in the same event loop pass are applied once
+    model->item(50, 5)->setText(QStringLiteral("hidden"));
+    model->item(1, 8)->setText(QStringLiteral("hidden"));
+    model->item(1, 1)->setText(QStringLiteral("first"));
+    model->item(1, 1)->setText(QStringLiteral("second"));
+    model->item(1, 1)->setText(QStringLiteral("third"));
+    QTRY_COMPARE(itemText(view->itemAt(1, 1)), QStringLiteral("third"));
+    for (int row = 0; row < 3; ++row)
+        for (int column = 0; column < 3; ++column)
+            QCOMPARE(updates(row, column), before[row * 3 + column] + (row == 1 && column == 1 ? 1 : 0));
+
+    // A change of another role leaves the bindings of the display role alone
+    model->item(2, 2)->setData(QStringLiteral("tip"), Qt::ToolTipRole);
+    model->item(0, 0)->setText(QStringLiteral("changed"));
+    QTRY_COMPARE(itemText(view->itemAt(0, 0)), QStringLiteral("changed"));
+    QCOMPARE(updates(2, 2), before[8]);
+    QCOMPARE(itemText(view->itemAt(2, 2)), QStringLiteral("2,2"));
+
+    // Cells read the changes they missed when they are shown
+    fixture.root()->setProperty("contentY", 5000);
+    fixture.root()->setProperty("contentX", 500);
+    QTRY_COMPARE(itemText(view->itemAt(50, 5)), QStringLiteral("hidden"));
+}
+
+void TableViewTest::testRecycledContext()
+{
+    QStandardItemModel *model = createModel(100, 2, this);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 200
+            height: 200
+            model: testModel
+            cellDelegate: Item {
+                property string text: model.display
+                property int cellRow: row
+                property int cellColumn: column
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QTRY_COMPARE(fixture.itemCount(), 4);
+    QSet<QQuickItem*> items;
+    for (QQuickItem *item : view->childItems())
+        items.insert(item);
+
+    // The items of the rows scrolled out are reused for the rows scrolled in,
+    // with the data and the cell of their new model index
+    fixture.root()->setProperty("contentY", 1000);
+    QTRY_COMPARE(itemText(view->itemAt(10, 1)), QStringLiteral("10,1"));
+    QTRY_COMPARE(fixture.itemCount(), 4);
+    for (int row = 10; row < 12; ++row) {
+        for (int column = 0; column < 2; ++column) {
+            QQuickItem *item = view->itemAt(row, column);
+            QVERIFY(items.contains(item));
+            QCOMPARE(itemText(item), QStringLiteral("%1,%2").arg(row).arg(column));
+            QCOMPARE(item->property("cellRow").toInt(), row);
+            QCOMPARE(item->property("cellColumn").toInt(), column);
+        }
+    }
+
+    // A reordered axis feeds the model index of the view position
+    QVERIFY(view->setColumnOrder({1, 0}));
+    QTRY_COMPARE(itemText(view->itemAt(10, 0)), QStringLiteral("10,1"));
+    QCOMPARE(view->itemAt(10, 0)->property("cellColumn").toInt(), 1);
+    QCOMPARE(view->itemAt(10, 1)->property("cellColumn").toInt(), 0);
+}
+
+void TableViewTest::testIncubationBudget()
+{
+    // Every delegate takes twice the budget to complete
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 400
+            height: 400
+            rowCount: 4
+            columnCount: 4
+            incubationBudget: 5
+            cellDelegate: Item {
+                Component.onCompleted: {
+                    var end = Date.now() + 10
+                    while (Date.now() < end) {}
+                }
+            }
+        }
+    )");
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+
+    std::vector<int> counts;
+    QObject::connect(fixture.window(), &QQuickWindow::frameSwapped, view, [&] {
+        counts.push_back(fixture.itemCount());
+    });
+    QTRY_COMPARE(fixture.itemCount(), 16);
+    QTRY_VERIFY(!counts.empty() && counts.back() == 16);
+
+    // The items are spread over many frames, each one completing at most
+    // the delegate it started within the budget and another one
+    int previous = 0;
+    for (int count : counts) {
+        QVERIFY(count - previous <= 2);
+        previous = count;
+    }
+    QVERIFY(counts.size() >= 8);
+}
+
+void TableViewTest::testEngineIncubationController()
+{
+    // The controller of the engine is kept, and incubates the delegates
+    // only when it is driven
+    QQmlIncubationController controller;
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 400
+            height: 400
+            rowCount: 4
+            columnCount: 4
+            cellDelegate: Item {}
+        }
+    )", nullptr, &controller);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QCOMPARE(qmlEngine(view)->incubationController(), &controller);
+    QTest::qWait(50);
+    QCOMPARE(fixture.itemCount(), 0);
+
+    QTimer driver;
+    QObject::connect(&driver, &QTimer::timeout, [&] { controller.incubateFor(5); });
+    driver.start(1);
+    QTRY_COMPARE(fixture.itemCount(), 16);
+    QCOMPARE(qmlEngine(view)->incubationController(), &controller);
+}
+
+void TableViewTest::testOverscanPriority()
+{
+    // The cache buffer covers two rows above and below the visible ones
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 200
+            height: 200
+            rowCount: 50
+            columnCount: 2
+            verticalCacheBuffer: 400
+            incubationBudget: 5
+            cellDelegate: Item {
+                Component.onCompleted: {
+                    var end = Date.now() + 10
+                    while (Date.now() < end) {}
+                }
+            }
+        }
+    )");
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+
+    // Items completed in the cache area imply that the visible cells all have one
+    auto visibleRows = [&] {
+        const int top = qFloor(fixture.root()->property("contentY").toReal() / 100);
+        return std::make_pair(top, top + 1);
+    };
+    std::vector<QQuickItem*> items(20 * 2, nullptr);
+    bool overscanFirst = false;
+    QObject::connect(fixture.window(), &QQuickWindow::frameSwapped, view, [&] {
+        const std::pair<int, int> rows = visibleRows();
+        bool newInCache = false;
+        bool visibleComplete = true;
+        for (int row = 0; row < 20; ++row) {
+            for (int column = 0; column < 2; ++column) {
+                QQuickItem *item = view->itemAt(row, column);
+                const bool visible = row >= rows.first && row <= rows.second;
+                if (item && item != items[row * 2 + column] && !visible)
+                    newInCache = true;
+                if (!item && visible)
+                    visibleComplete = false;
+                items[row * 2 + column] = item;
+            }
+        }
+        overscanFirst = overscanFirst || (newInCache && !visibleComplete);
+    });
+
+    // Scroll while the cache area is incubating, so that visible cells are
+    // queued behind it
+    QTRY_VERIFY(view->itemAt(2, 0) || view->itemAt(2, 1));
+    fixture.root()->setProperty("contentY", 300);
+    for (int row = 1; row <= 6; ++row) {
+        QTRY_VERIFY(view->itemAt(row, 0));
+        QTRY_VERIFY(view->itemAt(row, 1));
+    }
+    QVERIFY(!overscanFirst);
+}
+
+void TableViewTest::testPoolTrim()
+{
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 200
+            height: 300
+            rowCount: 100
+            columnCount: 2
+            poolIdleTimeout: 0
+            delegateChooser: DelegateChooser {
+                DelegateChoice { column: 0; delegate: Item {} }
+                DelegateChoice { column: 1; delegate: Item {} }
+            }
+        }
+    )");
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QTRY_COMPARE(fixture.itemCount(), 6);
+    QCOMPARE(view->poolHighWaterMark(), 0);
+
+    // The released rows fill a pool per delegate
+    fixture.root()->setHeight(100);
+    QCOMPARE(fixture.itemCount(), 2);
+    QCOMPARE(fixture.hiddenItemCount(), 4);
+    QCOMPARE(view->poolHighWaterMark(), 4);
+
+    // Exactly the excess of the pools is destroyed, even when it is below
+    // the number of pools
+    view->setPoolSize(3);
+    QCOMPARE(fixture.hiddenItemCount(), 3);
+    view->setPoolSize(1);
+    QCOMPARE(fixture.hiddenItemCount(), 1);
+    view->setPoolSize(-1);
+    view->trimCache();
+    QCOMPARE(fixture.hiddenItemCount(), 0);
+    QCOMPARE(view->poolHighWaterMark(), 4);
+
+    // The rows shown again incubate new items
+    fixture.root()->setHeight(300);
+    QCOMPARE(fixture.itemCount(), 2);
+    QTRY_COMPARE(fixture.itemCount(), 6);
+}
+
+void TableViewTest::testDelegateChooser()
+{
+    QStandardItemModel *model = createModel(100, 1, this);
+    for (int row = 0; row < 100; ++row)
+        model->item(row, 0)->setToolTip(row % 2 == 0 ? QStringLiteral("text") : QStringLiteral("check"));
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 200
+            model: testModel
+            delegateChooser: DelegateChooser {
+                role: "toolTip"
+                DelegateChoice { roleValue: "text"; delegate: Item { objectName: "text" } }
+                DelegateChoice { roleValue: "check"; delegate: Item { objectName: "check" } }
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QTRY_COMPARE(fixture.itemCount(), 2);
+    QCOMPARE(view->itemAt(0, 0)->objectName(), QStringLiteral("text"));
+    QCOMPARE(view->itemAt(1, 0)->objectName(), QStringLiteral("check"));
+
+    // Each row reuses an item of its own delegate from the pools
+    QSet<QQuickItem*> items;
+    for (QQuickItem *item : view->childItems())
+        items.insert(item);
+    for (int top = 1; top < 10; ++top) {
+        fixture.root()->setProperty("contentY", top * 100);
+        QTRY_VERIFY(view->itemAt(top, 0) && view->itemAt(top + 1, 0));
+        for (int row = top; row < top + 2; ++row) {
+            QCOMPARE(view->itemAt(row, 0)->objectName(), row % 2 == 0 ? QStringLiteral("text") : QStringLiteral("check"));
+            items.insert(view->itemAt(row, 0));
+        }
+    }
+    QCOMPARE(items.size(), 4);
+    QCOMPARE(view->childItems().size(), 4);
+
+    // A cell whose role value changes incubates an item of the other delegate
+    // in place of its own, and leaves the pooled items alone
+    model->item(9, 0)->setToolTip(QStringLiteral("text"));
+    QTRY_COMPARE(view->itemAt(9, 0)->objectName(), QStringLiteral("text"));
+    QCOMPARE(fixture.itemCount(), 2);
+    QCOMPARE(fixture.hiddenItemCount(), 2);
+}
+
+void TableViewTest::testDestroyedDelegate()
+{
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 200
+            rowCount: 20
+            columnCount: 1
+        }
+    )");
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    auto delegate = new QQmlComponent(qmlEngine(view), view);
+    delegate->setData("import QtQuick 2.8\nItem {}", QUrl());
+    view->setCellDelegate(delegate);
+    QTRY_COMPARE(fixture.itemCount(), 2);
+
+    // The pool of a destroyed delegate is dropped with its items
+    view->setLightweightCells(true);
+    QCOMPARE(fixture.hiddenItemCount(), 2);
+    delete delegate;
+    QCOMPARE(view->childItems().size(), 0);
+}
+
+void TableViewTest::testLightweightCells()
+{
+    QStandardItemModel *model = createModel(20, 2, this);
+    model->item(0, 0)->setBackground(QColor(Qt::red));
+    model->item(0, 1)->setBackground(QColor(Qt::blue));
+    model->item(1, 0)->setData(QColor(Qt::yellow), Qt::BackgroundRole);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 200
+            height: 200
+            model: testModel
+            lightweightCells: true
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QVERIFY(QTest::qWaitForWindowExposed(fixture.window()));
+
+    // Return whether the cell at x and y in the window shows some text
+    // over its background, which shows at its corner
+    auto hasText = [](const QImage &image, int x, int y) {
+        const QRgb background = image.pixel(x + 1, y + 1);
+        for (int i = y; i < y + 100; ++i)
+            for (int j = x; j < x + 100; ++j)
+                if (image.pixel(j, i) != background)
+                    return true;
+        return false;
+    };
+    QImage image = fixture.window()->grabWindow();
+    QCOMPARE(image.pixel(1, 1), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(101, 1), qRgb(0, 0, 255));
+    QCOMPARE(image.pixel(1, 101), qRgb(255, 255, 0));
+    QCOMPARE(image.pixel(101, 101), qRgb(255, 255, 255));
+    QVERIFY(hasText(image, 0, 0));
+    QVERIFY(hasText(image, 100, 100));
+    QCOMPARE(fixture.itemCount(), 0);
+
+    // Changes of the model reach the cells drawn
+    model->item(0, 0)->setBackground(QColor(Qt::green));
+    model->item(1, 1)->setText(QString());
+    QTRY_COMPARE(fixture.window()->grabWindow().pixel(1, 1), qRgb(0, 255, 0));
+    image = fixture.window()->grabWindow();
+    QVERIFY(!hasText(image, 100, 100));
+    QVERIFY(hasText(image, 0, 100));
+
+    // Scrolling shows the cells of the next rows
+    fixture.root()->setProperty("contentY", 100);
+    QTRY_COMPARE(fixture.window()->grabWindow().pixel(1, 1), qRgb(255, 255, 0));
+    image = fixture.window()->grabWindow();
+    QCOMPARE(image.pixel(1, 101), qRgb(255, 255, 255));
+    QVERIFY(hasText(image, 0, 100));
+}
+
+void TableViewTest::testLayoutChange()
+{
+    auto source = new QStandardItemModel(this);
+    for (int row = 0; row < 10; ++row)
+        source->appendRow(new QStandardItem(QStringLiteral("r%1").arg(row)));
+    auto model = new QSortFilterProxyModel(this);
+    model->setSourceModel(source);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 1000
+            model: testModel
+            defaultRowHeight: 50
+            cellDelegate: Item {
+                property string text: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QVERIFY(view->hideRows(2, 1));
+    QCOMPARE(view->height(), 450.0);
+    QTRY_COMPARE(fixture.itemCount(), 9);
+
+    // The hidden row follows its model row through the sort
+    model->sort(0, Qt::DescendingOrder);
+    QCOMPARE(view->rowCount(), 10);
+    QCOMPARE(view->height(), 450.0);
+    QTRY_COMPARE(fixture.itemCount(), 9);
+    QVERIFY(!view->itemAt(7, 0));
+    QCOMPARE(itemText(view->itemAt(0, 0)), QStringLiteral("r9"));
+    QCOMPARE(itemText(view->itemAt(6, 0)), QStringLiteral("r3"));
+    QCOMPARE(itemText(view->itemAt(8, 0)), QStringLiteral("r1"));
+    QCOMPARE(view->itemAt(6, 0)->position(), QPointF(0, 300));
+    QCOMPARE(view->itemAt(8, 0)->position(), QPointF(0, 350));
+}
+
+void TableViewTest::testModelResetSameCount()
+{
+    auto model = new QStringListModel({QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c")}, this);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 300
+            model: testModel
+            defaultRowHeight: 50
+            cellDelegate: Item {
+                property string text: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QVERIFY(view->hideRows(1, 1));
+    QCOMPARE(view->height(), 100.0);
+    QTRY_COMPARE(fixture.itemCount(), 2);
+
+    // A reset rebuilds the rows even though their count is the same
+    QSignalSpy rowCountSpy(view, &TableViewPrivate::rowCountChanged);
+    model->setStringList({QStringLiteral("x"), QStringLiteral("y"), QStringLiteral("z")});
+    QCOMPARE(view->rowCount(), 3);
+    QCOMPARE(rowCountSpy.count(), 0);
+    QCOMPARE(view->height(), 150.0);
+    QTRY_COMPARE(fixture.itemCount(), 3);
+    QCOMPARE(itemText(view->itemAt(1, 0)), QStringLiteral("y"));
+    QCOMPARE(view->itemAt(2, 0)->position(), QPointF(0, 100));
+}
+
+void TableViewTest::testAutoRowHeight()
+{
+    auto model = new QStandardItemModel(10, 1, this);
+    for (int row = 0; row < 10; ++row)
+        model->setData(model->index(row, 0), 40);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 1000
+            model: testModel
+            defaultRowHeight: 50
+            autoRowHeight: true
+            cellDelegate: Item {
+                implicitHeight: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+
+    // Rows take the height of their items once they are incubated
+    QTRY_COMPARE(fixture.itemCount(), 10);
+    QTRY_COMPARE(view->height(), 400.0);
+    QCOMPARE(view->itemAt(3, 0)->position(), QPointF(0, 120));
+    QCOMPARE(view->itemAt(3, 0)->height(), 40.0);
+
+    // A change of an implicit height resizes its row and moves the ones below
+    model->setData(model->index(1, 0), 100);
+    QTRY_COMPARE(view->itemAt(1, 0)->height(), 100.0);
+    QCOMPARE(view->height(), 460.0);
+    QCOMPARE(view->itemAt(0, 0)->position(), QPointF(0, 0));
+    QCOMPARE(view->itemAt(2, 0)->position(), QPointF(0, 140));
+    QCOMPARE(view->itemAt(9, 0)->position(), QPointF(0, 420));
+
+    // A row waiting for its measurement moves with an inserted row
+    view->itemAt(1, 0)->setProperty("implicitHeight", 60);
+    model->insertRow(0);
+    model->setData(model->index(0, 0), 40);
+    QTRY_COMPARE(view->itemAt(2, 0)->height(), 60.0);
+    QTRY_COMPARE(view->height(), 460.0);
+    QCOMPARE(view->itemAt(1, 0)->height(), 40.0);
+    QCOMPARE(view->itemAt(3, 0)->position(), QPointF(0, 140));
+}
+
+void TableViewTest::testDefaultRowHeight()
+{
+    // Items without an implicit height leave their row to the default
+    auto model = new QStandardItemModel(5, 1, this);
+    for (int row = 0; row < 5; ++row)
+        model->setData(model->index(row, 0), row == 1 ? 100 : 0);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 500
+            model: testModel
+            defaultRowHeight: 50
+            defaultColumnWidth: 80
+            autoRowHeight: true
+            cellDelegate: Item {
+                implicitHeight: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QTRY_COMPARE(fixture.itemCount(), 5);
+    QTRY_COMPARE(view->height(), 300.0);
+
+    // The measured row keeps its height when the default changes
+    view->setDefaultRowHeight(30);
+    QCOMPARE(view->height(), 220.0);
+    QCOMPARE(view->itemAt(1, 0)->height(), 100.0);
+    QCOMPARE(view->itemAt(2, 0)->height(), 30.0);
+    QCOMPARE(view->itemAt(2, 0)->position(), QPointF(0, 130));
+    QCOMPARE(view->itemAt(4, 0)->position(), QPointF(0, 190));
+
+    view->setDefaultColumnWidth(60);
+    QCOMPARE(view->width(), 60.0);
+    QCOMPARE(view->itemAt(1, 0)->size(), QSizeF(60, 100));
+
+    // Default sizes are at least one pixel
+    view->setDefaultRowHeight(0);
+    QCOMPARE(view->defaultRowHeight(), 1);
+    QCOMPARE(view->height(), 104.0);
+    view->setDefaultColumnWidth(-10);
+    QCOMPARE(view->defaultColumnWidth(), 1);
+    QCOMPARE(view->width(), 1.0);
+}
+
+void TableViewTest::testDeepScrolling()
+{
+    // 100 million rows are 2e9 pixels high, far beyond the content window
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 100
+            rowCount: 100000000
+            columnCount: 1
+            defaultRowHeight: 20
+            maximumFlickVelocity: 10000000
+            flickDeceleration: 1
+            cellDelegate: Item {
+                property int text: row
+            }
+        }
+    )");
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QQuickItem *root = fixture.root();
+    QCOMPARE(root->property("tableHeight").toReal(), 2e9);
+    QVERIFY(root->property("contentHeight").toReal() < 2e9);
+    QTRY_COMPARE(fixture.itemCount(), 5);
+
+    // Scrolling to a position of the table moves the content window there
+    QMetaObject::invokeMethod(root, "scrollTo", Q_ARG(QVariant, 0), Q_ARG(QVariant, 1e9 + 10));
+    QCOMPARE(root->property("tableY").toReal(), 1e9 + 10);
+    QCOMPARE(view->origin().y() + root->property("contentY").toReal(), 1e9 + 10);
+    QTRY_VERIFY(view->itemAt(50000000, 0));
+    QCOMPARE(view->itemAt(50000000, 0)->property("text").toInt(), 50000000);
+    QCOMPARE(view->origin().y() + view->itemAt(50000000, 0)->y(), 1e9);
+
+    // A flick goes on through the rebases of the content window
+    const qreal start = root->property("tableY").toReal();
+    QMetaObject::invokeMethod(root, "flick", Q_ARG(qreal, 0), Q_ARG(qreal, -1000000));
+    QTRY_VERIFY_WITH_TIMEOUT(root->property("tableY").toReal() > start + 3 * (1 << 20), 10000);
+    QVERIFY(root->property("flicking").toBool());
+    QVERIFY(root->property("contentY").toReal() < (1 << 20));
+    QMetaObject::invokeMethod(root, "cancelFlick");
+    const int top = qFloor(root->property("tableY").toReal() / 20);
+    QTRY_VERIFY(view->itemAt(top + 2, 0));
+    QCOMPARE(view->itemAt(top + 2, 0)->property("text").toInt(), top + 2);
+}
+
+void TableViewTest::testMeasurementAnchoring()
+{
+    // Items without an implicit height leave their row to the estimate
+    auto model = new QStandardItemModel(100, 1, this);
+    for (int row = 0; row < 100; ++row)
+        model->setData(model->index(row, 0), 0);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 100
+            height: 200
+            model: testModel
+            defaultRowHeight: 50
+            autoRowHeight: true
+            verticalCacheBuffer: 500
+            cellDelegate: Item {
+                implicitHeight: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QQuickItem *root = fixture.root();
+    root->setProperty("contentY", 1000);
+    QTRY_VERIFY(view->itemAt(15, 0) && view->itemAt(20, 0));
+    QCOMPARE(view->height(), 5000.0);
+    auto screenY = [&](int row) {
+        return view->itemAt(row, 0)->y() - root->property("contentY").toReal();
+    };
+    QCOMPARE(screenY(20), 0.0);
+
+    // A row measured above the visible ones does not move them
+    model->setData(model->index(15, 0), 150);
+    QTRY_COMPARE(view->itemAt(15, 0)->height(), 150.0);
+    QCOMPARE(view->height(), 5100.0);
+    QCOMPARE(screenY(20), 0.0);
+    QCOMPARE(screenY(21), 50.0);
+
+    // While a row measured in the visible area moves the ones below it
+    model->setData(model->index(20, 0), 80);
+    QTRY_COMPARE(view->itemAt(20, 0)->height(), 80.0);
+    QCOMPARE(screenY(20), 0.0);
+    QCOMPARE(screenY(21), 80.0);
+}
+
+void TableViewTest::testFrozenCells()
+{
+    QStandardItemModel *model = createModel(100, 20, this);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 300
+            height: 300
+            model: testModel
+            frozenRows: 1
+            frozenColumns: 1
+            cellDelegate: Item {
+                property string text: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QQuickItem *root = fixture.root();
+    QTRY_COMPARE(fixture.itemCount(), 9);
+    QQuickItem *corner = view->itemAt(0, 0);
+    QQuickItem *header = view->itemAt(0, 1);
+    QQuickItem *rowHeader = view->itemAt(1, 0);
+
+    // Frozen cells follow the visible area in the same pass as the body,
+    // and stack over it
+    root->setProperty("contentX", 50);
+    root->setProperty("contentY", 30);
+    QCOMPARE(corner->position(), QPointF(50, 30));
+    QCOMPARE(header->position(), QPointF(100, 30));
+    QCOMPARE(rowHeader->position(), QPointF(50, 100));
+    QVERIFY(header->z() > view->itemAt(1, 1)->z());
+    QVERIFY(corner->z() > header->z());
+
+    // Scrolled out body cells leave the frozen ones to the header rows and columns
+    root->setProperty("contentX", 1000);
+    root->setProperty("contentY", 5000);
+    QCOMPARE(view->itemAt(0, 0), corner);
+    QCOMPARE(corner->position(), QPointF(1000, 5000));
+    QTRY_VERIFY(view->itemAt(0, 11) && view->itemAt(51, 0) && view->itemAt(51, 11));
+    QCOMPARE(view->itemAt(0, 11)->position(), QPointF(1100, 5000));
+    QCOMPARE(itemText(view->itemAt(0, 11)), QStringLiteral("0,11"));
+    QCOMPARE(view->itemAt(51, 0)->position(), QPointF(1000, 5100));
+    QCOMPARE(itemText(view->itemAt(51, 0)), QStringLiteral("51,0"));
+    QCOMPARE(view->itemAt(51, 11)->position(), QPointF(1100, 5100));
+    QVERIFY(!view->itemAt(1, 1));
+}
+
+void TableViewTest::testSpansFollowModel()
+{
+    QStandardItemModel *model = createModel(20, 5, this);
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        TableView {
+            width: 500
+            height: 500
+            model: testModel
+            cellDelegate: Item {
+                property string text: model.display
+            }
+        }
+    )", model);
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+    QVERIFY(view->setSpan(2, 1, 2, 2));
+    QTRY_VERIFY(view->itemAt(2, 1));
+    QCOMPARE(view->itemAt(2, 1)->size(), QSizeF(200, 200));
+
+    // A row inserted inside the span grows it, and the rows below stay unmerged
+    model->insertRow(3, QList<QStandardItem*>() << new QStandardItem(QStringLiteral("new")));
+    QTRY_COMPARE(view->itemAt(2, 1)->size(), QSizeF(200, 300));
+    QVERIFY(!view->itemAt(4, 2));
+    QTRY_COMPARE(itemText(view->itemAt(5, 1)), QStringLiteral("4,1"));
+
+    // Rows removed before the span move it, and the ones inside shrink it
+    model->removeRows(0, 1);
+    QTRY_COMPARE(view->itemAt(1, 1)->size(), QSizeF(200, 300));
+    QCOMPARE(itemText(view->itemAt(1, 1)), QStringLiteral("2,1"));
+    model->removeRows(2, 2);
+    QTRY_COMPARE(view->itemAt(1, 1)->size(), QSizeF(200, 100));
+    QTRY_COMPARE(itemText(view->itemAt(2, 1)), QStringLiteral("4,1"));
+
+    // A span left with a single cell is dropped
+    model->removeColumns(2, 1);
+    QTRY_COMPARE(view->itemAt(1, 1)->size(), QSizeF(100, 100));
+    QTRY_COMPARE(itemText(view->itemAt(1, 2)), QStringLiteral("2,3"));
+}
+
+void TableViewTest::testListView()
+{
+    ViewFixture fixture(R"(
+        import QtQuick 2.8
+        import AdvancedViews 1.0
+        ListView {
+            width: 150
+            height: 200
+            model: testModel
+            cacheBuffer: 0
+            delegate: Item {
+                implicitHeight: 20
+                property string text: model.display
+            }
+        }
+    )", createModel(1000, 1, this));
+    TableViewPrivate *view = fixture.view();
+    QVERIFY(view);
+
+    // Only the items of the visible rows are created, as wide as the list
+    QTRY_COMPARE(fixture.itemCount(), 10);
+    QCOMPARE(view->childItems().size(), 10);
+    QQuickItem *item = view->itemAt(3, 0);
+    QCOMPARE(itemText(item), QStringLiteral("3,0"));
+    QCOMPARE(item->position(), QPointF(0, 60));
+    QCOMPARE(item->width(), 150.0);
+
+    // A change of width resizes the same items without laying out the column
+    fixture.root()->setWidth(300);
+    QCOMPARE(view->itemAt(3, 0), item);
+    QCOMPARE(item->width(), 300.0);
+    QCOMPARE(view->width(), 1.0);
+    QCOMPARE(fixture.itemCount(), 10);
+
+    // Scrolling keeps the number of items bounded by the visible rows
+    fixture.root()->setProperty("contentY", 10000);
+    QTRY_COMPARE(itemText(view->itemAt(500, 0)), QStringLiteral("500,0"));
+    QTRY_COMPARE(fixture.itemCount(), 10);
+    QVERIFY(view->childItems().size() <= 20);
+    QCOMPARE(view->itemAt(500, 0)->width(), 300.0);
+}
+
+QTEST_MAIN(TableViewTest)
+
+#include "tst_tableview.moc"